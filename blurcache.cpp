@@ -0,0 +1,123 @@
+#include "blurcache.h"
+#include "recursivegaussian.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+BlurCache::BlurCache(size_t budgetBytes) :
+    m_backend(Gaussian),
+    m_budget(budgetBytes),
+    m_used(0)
+{
+}
+
+void BlurCache::setImage(const cv::Mat &image)
+{
+    clear();
+    m_image = image;
+}
+
+void BlurCache::clear()
+{
+    m_entries.clear();
+    m_index.clear();
+    m_used = 0;
+}
+
+void BlurCache::setBudget(size_t budgetBytes)
+{
+    m_budget = budgetBytes;
+    evict();
+}
+
+const cv::Mat& BlurCache::get(int kernel)
+{
+    return get(kernel, cv::Rect(0, 0, m_image.cols, m_image.rows));
+}
+
+const cv::Mat& BlurCache::get(int kernel, const cv::Rect &region)
+{
+    Key key(m_backend, kernel);
+    std::map<Key, std::list<Entry>::iterator>::iterator found = m_index.find(key);
+    if(found != m_index.end()){
+        m_entries.splice(m_entries.begin(), m_entries, found->second);     // mark as most recently used
+    }
+    else{
+        Entry entry;
+        entry.key = key;
+        if(kernel > 1){
+            entry.blurred.create(m_image.size(), m_image.type());
+            m_used += entry.blurred.total() * entry.blurred.elemSize();
+        }
+        else{
+            entry.blurred = m_image;    // kernel 1 is the identity, share the source
+            entry.valid = cv::Rect(0, 0, m_image.cols, m_image.rows);
+        }
+        m_entries.push_front(entry);
+        m_index[key] = m_entries.begin();
+    }
+
+    Entry &entry = m_entries.front();
+    cv::Rect wanted = region & cv::Rect(0, 0, m_image.cols, m_image.rows);
+
+    if((entry.valid & wanted) != wanted){
+        cv::Rect old = entry.valid;
+        cv::Rect box = old.area() ? (old | wanted) : wanted;
+        if(!old.area()){
+            blurRegion(entry, box);
+        }
+        else{
+            //the box minus the old rectangle: full-width strips above and
+            //below it, and the parts left and right of it in between
+            cv::Rect strips[4] = {
+                cv::Rect(box.x, box.y, box.width, old.y - box.y),
+                cv::Rect(box.x, old.br().y, box.width, box.br().y - old.br().y),
+                cv::Rect(box.x, old.y, old.x - box.x, old.height),
+                cv::Rect(old.br().x, old.y, box.br().x - old.br().x, old.height)
+            };
+            for(int i = 0; i < 4; i++)
+                if(strips[i].area() > 0)
+                    blurRegion(entry, strips[i]);
+        }
+        entry.valid = box;
+    }
+
+    evict();
+    return m_entries.front().blurred;
+}
+
+void BlurCache::blurRegion(Entry &entry, const cv::Rect &region) const
+{
+    int kernel = entry.key.second;
+    cv::Mat dst = entry.blurred(region);
+
+    if(entry.key.first == Recursive){
+        //the IIR filter treats its input edges as image borders, so run it
+        //on the region grown by the filter support and keep the centre
+        double sigma = kernelSigma(kernel);
+        int margin = recursiveGaussianMargin(sigma);
+        cv::Rect grown(region.x-margin, region.y-margin, region.width+2*margin, region.height+2*margin);
+        grown &= cv::Rect(0, 0, m_image.cols, m_image.rows);
+
+        cv::Mat blurred;
+        recursiveGaussianBlur(m_image(grown), blurred, sigma);
+        blurred(region - grown.tl()).copyTo(dst);
+        return;
+    }
+
+    //Filtering a ROI view reads the kernel radius around it from the
+    //parent image and only reflects at the real image border, so the
+    //pixels come out identical to a full-frame GaussianBlur.
+    cv::GaussianBlur(m_image(region), dst, cv::Size(kernel,kernel), 0, 0);
+}
+
+void BlurCache::evict()
+{
+    //never evict the entry just handed out, even if it alone exceeds the budget
+    while(m_used > m_budget && m_entries.size() > 1){
+        Entry &last = m_entries.back();
+        if(last.key.second > 1)
+            m_used -= last.blurred.total() * last.blurred.elemSize();
+        m_index.erase(last.key);
+        m_entries.pop_back();
+    }
+}
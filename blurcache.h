@@ -0,0 +1,70 @@
+#ifndef BLURCACHE_H
+#define BLURCACHE_H
+
+#include <list>
+#include <map>
+
+#include <opencv2/core/core.hpp>
+
+// Gaussian smoothed copies of one source image, keyed by kernel size.
+// Every offset line and ray of a measurement reads the same smoothed image,
+// so it is blurred once and reused. Entries over the memory budget are
+// evicted least-recently-used first.
+//
+// Each entry is a full-size image of which only the "valid" rectangle has
+// been blurred so far. Asking for a region outside it grows "valid" to the
+// bounding box of both and blurs only the strips around the old rectangle,
+// never the pixels already smoothed. A short measurement line on a large
+// frame skips the full-frame filter pass; the memory is still a full frame
+// per kernel, allocated on first use and charged to the budget as such.
+class BlurCache
+{
+public:
+    enum Backend {
+        Gaussian = 0,       // cv::GaussianBlur, cost grows with the kernel
+        Recursive = 1       // recursiveGaussianBlur, constant cost per pixel
+    };
+
+    explicit BlurCache(size_t budgetBytes = 256*1024*1024);
+
+    void setImage(const cv::Mat &image);    // drops every cached entry
+    void clear();
+
+    void setBudget(size_t budgetBytes);
+    size_t budget() const { return m_budget; }
+    size_t usedBytes() const { return m_used; }
+
+    void setBackend(Backend backend) { m_backend = backend; }   // entries of both backends are kept
+    Backend backend() const { return m_backend; }
+
+    // Smoothed image for an odd kernel size, blurred on first use.
+    // The reference stays valid until the next call.
+    const cv::Mat& get(int kernel);
+
+    // Same, but only the pixels inside "region" are guaranteed to be
+    // smoothed. They match the full-frame result pixel for pixel (for the
+    // recursive backend, up to the filter's negligible far tail).
+    const cv::Mat& get(int kernel, const cv::Rect &region);
+
+private:
+    typedef std::pair<int,int> Key;     // (backend, kernel)
+
+    struct Entry
+    {
+        Key key;
+        cv::Mat blurred;
+        cv::Rect valid;     //part of "blurred" that holds smoothed pixels
+    };
+
+    void evict();
+    void blurRegion(Entry &entry, const cv::Rect &region) const;
+
+    cv::Mat m_image;
+    std::list<Entry> m_entries;                             // front = most recently used
+    std::map<Key, std::list<Entry>::iterator> m_index;
+    Backend m_backend;
+    size_t m_budget;
+    size_t m_used;
+};
+
+#endif // BLURCACHE_H
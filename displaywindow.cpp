@@ -0,0 +1,108 @@
+#include "displaywindow.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const int histogramBins = 4096;
+const double clipFraction = 0.005;     // cut at each end by fit()
+
+// histogram of "image" over [low, high], "histogramBins" wide
+template<typename P>
+void accumulate(const cv::Mat &image, double low, double high, std::vector<int64> &histogram)
+{
+    double toBin = (histogramBins - 1) / (high - low);
+    for(int y = 0; y < image.rows; y++){
+        const P *row = image.ptr<P>(y);
+        for(int x = 0; x < image.cols; x++){
+            double v = row[x];
+            if(v >= low && v <= high)   //NaN in float images drops out here
+                histogram[(int)((v - low) * toBin)]++;
+        }
+    }
+}
+
+} // namespace
+
+DisplayWindow::DisplayWindow() :
+    m_low(0),
+    m_high(255)
+{
+    set(0, 255);
+}
+
+void DisplayWindow::set(double low, double high)
+{
+    if(!(high > low))
+        high = low + 1;
+    m_low = low;
+    m_high = high;
+    m_lut.resize(65536);
+    double scale = 255 / (high - low);
+    for(int v = 0; v < 65536; v++)
+        m_lut[v] = cv::saturate_cast<uchar>((v - low) * scale);
+}
+
+void DisplayWindow::reset(int type)
+{
+    switch(CV_MAT_DEPTH(type)){
+    case CV_16U: set(0, 65535); break;
+    case CV_32F: set(0, 1); break;
+    default: set(0, 255); break;
+    }
+}
+
+void DisplayWindow::fit(const cv::Mat &image)
+{
+    if(image.empty() || (image.depth() != CV_16U && image.depth() != CV_32F)){
+        reset(image.type());
+        return;
+    }
+    double low = 0, high = 0;
+    cv::minMaxLoc(image, &low, &high);
+    if(!(high > low)){     //flat, or nothing but NaN
+        set(low, low + 1);
+        return;
+    }
+
+    std::vector<int64> histogram(histogramBins, 0);
+    if(image.depth() == CV_16U)
+        accumulate<ushort>(image, low, high, histogram);
+    else
+        accumulate<float>(image, low, high, histogram);
+    int64 total = 0;
+    for(int i = 0; i < histogramBins; i++)
+        total += histogram[i];
+    int64 clip = (int64)(total * clipFraction);
+
+    int first = 0, last = histogramBins - 1;
+    for(int64 below = histogram[first]; below <= clip && first < last; below += histogram[++first]);
+    for(int64 above = histogram[last]; above <= clip && last > first; above += histogram[--last]);
+    double binWidth = (high - low) / (histogramBins - 1);
+    set(low + first * binWidth, low + (last + 1) * binWidth);
+}
+
+cv::Mat DisplayWindow::apply(const cv::Mat &pixels) const
+{
+    CV_Assert(pixels.channels() == 1);
+    if(pixels.depth() == CV_8U)
+        return pixels;
+
+    cv::Mat out(pixels.size(), CV_8UC1);
+    if(pixels.depth() == CV_16U){
+        const uchar *lut = &m_lut[0];
+        for(int y = 0; y < pixels.rows; y++){
+            const ushort *src = pixels.ptr<ushort>(y);
+            uchar *dst = out.ptr<uchar>(y);
+            for(int x = 0; x < pixels.cols; x++)
+                dst[x] = lut[src[x]];
+        }
+    }
+    else{
+        double scale = 255 / (m_high - m_low);
+        pixels.convertTo(out, CV_8U, scale, -m_low * scale);
+    }
+    return out;
+}
@@ -0,0 +1,39 @@
+#ifndef DISPLAYWINDOW_H
+#define DISPLAYWINDOW_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// Grey window that brings 16-bit and float pixels down to the 8 bits the
+// screen shows: "low" is black, "high" white, linear in between and
+// clipped outside. 16-bit pixels are looked up in a 65536 entry table built
+// once per window, float ones take one scaled conversion; 8-bit pixels are
+// shown as they are. Only the display is windowed, the measurement always
+// reads the full depth.
+class DisplayWindow
+{
+public:
+    DisplayWindow();
+
+    void set(double low, double high);
+    double low() const { return m_low; }
+    double high() const { return m_high; }
+
+    // The whole range of "type": 0..255, 0..65535, or 0..1 for float.
+    void reset(int type);
+    // From the 0.5 and 99.5 percentiles of "image", an overview or a small
+    // pyramid level: a 12-bit sensor in a 16-bit container fills the screen
+    // range instead of its bottom 16th.
+    void fit(const cv::Mat &image);
+
+    // CV_8UC1 pixels of a single channel matrix; a 8-bit one is returned
+    // as it is, others are converted into a new matrix.
+    cv::Mat apply(const cv::Mat &pixels) const;
+
+private:
+    double m_low,m_high;
+    std::vector<uchar> m_lut;   // screen level of every 16-bit value
+};
+
+#endif // DISPLAYWINDOW_H
@@ -0,0 +1,149 @@
+#include "imageloader.h"
+
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+namespace
+{
+
+const qint64 previewMinBytes = 1 << 20;     // smaller files decode fast enough without one
+const int previewFactor = 8;
+const int overviewSide = 4096;              // longest side of a mapped file's overview
+
+// the pyramid of "image" and its grey window, fitted to the smallest level
+// of a full image or to the whole of a preview or overview
+void buildDisplay(const cv::Mat &image, bool fitToSmallest, ImageLoader::Display &display)
+{
+    display.pyramid.setImage(image);
+    if(fitToSmallest && !display.pyramid.empty())
+        display.window.fit(display.pyramid.level(display.pyramid.levels()-1));  //smallest level, one tile
+    else
+        display.window.fit(image);
+}
+
+ImageLoader::Decoded decodePreview(const QString &path)
+{
+    ImageLoader::Decoded d;
+    d.path = path;
+    buildDisplay(cv::imread(path.toStdString(), cv::IMREAD_REDUCED_GRAYSCALE_8), false, d.display);
+    d.factor = previewFactor;
+    return d;
+}
+
+ImageLoader::Decoded openSource(const QString &path, const RawFormat &rawFormat)
+{
+    ImageLoader::Decoded d;
+    d.path = path;
+    if(QFileInfo(path).suffix().toLower() == "raw")
+        d.source = openRawImageSource(path.toStdString(), rawFormat);
+    else
+        d.source = openImageSource(path.toStdString());
+    if(d.source && !d.source->decoded().empty())
+        buildDisplay(d.source->decoded(), true, d.display);
+    return d;
+}
+
+ImageLoader::Decoded overview(const QString &path, const cv::Ptr<ImageSource> &source)
+{
+    ImageLoader::Decoded d;
+    d.path = path;
+    d.source = source;
+    buildDisplay(imageOverview(*source, overviewSide, d.factor), false, d.display);
+    return d;
+}
+
+// only libjpeg scales while decoding, see IMREAD_REDUCED_GRAYSCALE_8
+bool previewWorthIt(const QString &path)
+{
+    QFileInfo info(path);
+    QString suffix = info.suffix().toLower();
+    return (suffix == "jpg" || suffix == "jpeg" || suffix == "jpe") && info.size() >= previewMinBytes;
+}
+
+} // namespace
+
+ImageLoader::ImageLoader(QObject *parent) :
+    QObject(parent),
+    m_imageDone(false)
+{
+    m_pool.setMaxThreadCount(2);
+    connect(&m_previewWatcher, SIGNAL(finished()), this, SLOT(previewFinished()));
+    connect(&m_imageWatcher, SIGNAL(finished()), this, SLOT(imageFinished()));
+}
+
+ImageLoader::~ImageLoader()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void ImageLoader::setRawFormat(const RawFormat &format)
+{
+    m_rawFormat = format;
+}
+
+void ImageLoader::load(const QString &path)
+{
+    m_path = path;
+    m_imageDone = false;
+
+    if(!m_prefetchPath.isEmpty() && path == m_prefetchPath){
+        //opened, or being opened, while the previous image was measured
+        m_imageWatcher.setFuture(m_prefetch);
+        m_prefetchPath.clear();
+        m_prefetch = QFuture<Decoded>();
+        return;
+    }
+
+    if(previewWorthIt(path))
+        m_previewWatcher.setFuture(QtConcurrent::run(&m_pool, decodePreview, path));
+    m_imageWatcher.setFuture(QtConcurrent::run(&m_pool, openSource, path, m_rawFormat));
+}
+
+void ImageLoader::prefetch(const QString &path)
+{
+    if(path.isEmpty() || path == m_prefetchPath || path == m_path)
+        return;
+    //an older prefetch still decoding just finishes unobserved
+    m_prefetchPath = path;
+    m_prefetch = QtConcurrent::run(&m_pool, openSource, path, m_rawFormat);
+}
+
+void ImageLoader::cancel()
+{
+    m_path.clear();
+}
+
+void ImageLoader::previewFinished()
+{
+    Decoded d = m_previewWatcher.result();
+    if(d.path != m_path || d.display.pyramid.empty())
+        return;     //superseded, or the preview failed (the full decode reports it)
+    if(d.source){   //overview of a mapped file, the image is in already
+        m_path.clear();
+        emit overviewReady(d.path, d.display, d.factor);
+    }
+    else if(!m_imageDone){
+        emit previewReady(d.path, d.display, d.factor);
+    }
+}
+
+void ImageLoader::imageFinished()
+{
+    Decoded d = m_imageWatcher.result();
+    if(d.path != m_path)
+        return;
+    m_imageDone = true;
+    if(!d.source){
+        m_path.clear();
+        emit loadFailed(d.path);
+        return;
+    }
+    if(d.source->decoded().empty())     //mapped: the display still needs an overview
+        m_previewWatcher.setFuture(QtConcurrent::run(&m_pool, overview, d.path, d.source));
+    else
+        m_path.clear();
+    emit imageReady(d.path, d.source, d.display);
+}
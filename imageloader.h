@@ -0,0 +1,85 @@
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include "displaywindow.h"
+#include "imagepyramid.h"
+#include "imagesource.h"
+
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <opencv2/core/core.hpp>
+
+// Opens grey images on background threads so the dialog never blocks on
+// cv::imread. A JPEG large enough to be worth it first gets a preview
+// decoded at 1/8 size, which libjpeg does while decompressing, at a small
+// fraction of the full decode; other codecs would decode everything and
+// then shrink, so they go straight to the full image.
+//
+// Files that can be memory mapped (see imagesource.h) are ready as soon as
+// their header is read. Their overview for the display comes afterwards,
+// read from one row in every few, while the image is measured already.
+// ".raw" files are mapped with the layout given to setRawFormat().
+//
+// What the view shows, the INTER_AREA pyramid and its grey window, is
+// built on the same threads too, for the image, the preview and the
+// overview alike; the GUI thread only takes it over.
+//
+// load() supersedes the image still loading: its results are dropped.
+// prefetch() opens the next image of a batch while the current one is
+// being measured; a later load() of the same path takes that over,
+// finished or not. All signals are emitted on the thread the loader lives
+// in, in order preview, then image or failure, then overview.
+class ImageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImageLoader(QObject *parent = 0);
+    ~ImageLoader();     // waits for the decodes still running
+
+    void setRawFormat(const RawFormat &format);
+    void load(const QString &path);
+    void prefetch(const QString &path);
+    void cancel();      // drops the results of the current load
+
+    struct Display
+    {
+        ImagePyramid pyramid;   // empty for a mapped file, until its overview
+        DisplayWindow window;
+    };
+
+    struct Decoded
+    {
+        Decoded() : factor(1) {}
+
+        QString path;
+        cv::Ptr<ImageSource> source;
+        Display display;    // of the decoded image, the reduced JPEG, or the overview of a mapped file
+        int factor;         // image pixels per preview pixel
+    };
+
+signals:
+    void previewReady(const QString &path, const ImageLoader::Display &preview, int factor);
+    void imageReady(const QString &path, const cv::Ptr<ImageSource> &source, const ImageLoader::Display &display);
+    void overviewReady(const QString &path, const ImageLoader::Display &overview, int factor);
+    void loadFailed(const QString &path);
+
+private slots:
+    void previewFinished();
+    void imageFinished();
+
+private:
+    QThreadPool m_pool;         // the current image and its preview, or a prefetch, decode side by side
+    QString m_path;             // image being loaded, or whose overview is, empty when none
+    bool m_imageDone;           // a late preview must not replace the full image
+    QFutureWatcher<Decoded> m_previewWatcher,m_imageWatcher;
+    QString m_prefetchPath;
+    QFuture<Decoded> m_prefetch;
+    RawFormat m_rawFormat;
+};
+
+#endif // IMAGELOADER_H
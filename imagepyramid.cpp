@@ -0,0 +1,53 @@
+#include "imagepyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+ImagePyramid::ImagePyramid(int tileSize) :
+    m_tileSize(std::max(tileSize, 16))
+{
+}
+
+void ImagePyramid::setImage(const cv::Mat &image)
+{
+    CV_Assert(image.empty() || image.type() == CV_8UC1 || image.type() == CV_16UC1 || image.type() == CV_32FC1);
+
+    m_levels.clear();
+    if(image.empty())
+        return;
+    m_levels.push_back(image);
+    while(m_levels.back().cols > m_tileSize || m_levels.back().rows > m_tileSize){
+        const cv::Mat &prev = m_levels.back();
+        cv::Mat next;
+        cv::resize(prev, next, cv::Size((prev.cols+1)/2, (prev.rows+1)/2), 0, 0, cv::INTER_AREA);
+        m_levels.push_back(next);
+    }
+}
+
+void ImagePyramid::clear()
+{
+    m_levels.clear();
+}
+
+int ImagePyramid::levelFor(double scale) const
+{
+    if(m_levels.empty() || scale >= 1)
+        return 0;
+    int k = (int)std::floor(std::log2(1 / scale));
+    return std::min(std::max(k, 0), levels()-1);
+}
+
+cv::Size ImagePyramid::tiles(int k) const
+{
+    const cv::Mat &m = m_levels[k];
+    return cv::Size((m.cols + m_tileSize-1) / m_tileSize, (m.rows + m_tileSize-1) / m_tileSize);
+}
+
+cv::Mat ImagePyramid::tile(int k, int tx, int ty) const
+{
+    const cv::Mat &m = m_levels[k];
+    cv::Rect r(tx*m_tileSize, ty*m_tileSize, m_tileSize, m_tileSize);
+    return m(r & cv::Rect(0, 0, m.cols, m.rows));
+}
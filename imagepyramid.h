@@ -0,0 +1,45 @@
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// Level of detail for the viewer: level 0 is the image itself (shared, not
+// copied), every next level half the size of the one before, area
+// averaged, down to a single tile. Together they add a third of the image
+// size. Tiles are views into the levels; the viewer turns only the
+// visible ones into pixmaps.
+//
+// setImage builds every level at once and they all stay in memory while
+// the pyramid lives. The byte budget of the viewer covers its tile pixmaps
+// only, so a decoded image costs its own size plus a third here. Mapped
+// files stay out of it: their pyramid is built from the overview.
+class ImagePyramid
+{
+public:
+    explicit ImagePyramid(int tileSize = 256);
+
+    void setImage(const cv::Mat &image);    // CV_8UC1, CV_16UC1 or CV_32FC1
+    void clear();
+
+    bool empty() const { return m_levels.empty(); }
+    int levels() const { return (int)m_levels.size(); }
+    int tileSize() const { return m_tileSize; }
+    const cv::Mat& level(int k) const { return m_levels[k]; }
+
+    // Coarsest level that still has at least one pixel per screen pixel at
+    // "scale" screen pixels per image pixel.
+    int levelFor(double scale) const;
+
+    // Tiles across and down level k, and the pixels of one of them (the
+    // last row and column are cut at the level's border).
+    cv::Size tiles(int k) const;
+    cv::Mat tile(int k, int tx, int ty) const;
+
+private:
+    int m_tileSize;
+    std::vector<cv::Mat> m_levels;
+};
+
+#endif // IMAGEPYRAMID_H
@@ -0,0 +1,485 @@
+#include "imagesource.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Read only mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile() : m_data(0), m_size(0) {}
+    ~MappedFile();
+
+    bool open(const std::string &path);
+    const uchar* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const uchar *m_data;
+    size_t m_size;
+};
+
+#ifdef _WIN32
+
+MappedFile::~MappedFile()
+{
+    if(m_data)
+        UnmapViewOfFile(m_data);
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, 0);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = 0;
+    if(GetFileSizeEx(file, &size) && size.QuadPart > 0 && (unsigned long long)size.QuadPart <= (size_t)-1)
+        mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if(mapping){
+        m_data = (const uchar*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        m_size = m_data ? (size_t)size.QuadPart : 0;
+        CloseHandle(mapping);   //the view keeps the mapping open
+    }
+    CloseHandle(file);
+    return m_data != 0;
+}
+
+#else
+
+MappedFile::~MappedFile()
+{
+    if(m_data)
+        munmap((void*)m_data, m_size);
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    if(fstat(fd, &info) == 0 && info.st_size > 0){
+        void *p = mmap(0, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(p != MAP_FAILED){
+            //regions are read here and there, read-ahead would pull in
+            //neighbouring rows nobody asked for
+            madvise(p, (size_t)info.st_size, MADV_RANDOM);
+            m_data = (const uchar*)p;
+            m_size = (size_t)info.st_size;
+        }
+    }
+    ::close(fd);   //the mapping keeps the file open
+    return m_data != 0;
+}
+
+#endif
+
+// Decoded by cv::imread.
+class MemorySource : public ImageSource
+{
+public:
+    explicit MemorySource(const cv::Mat &image) : m_image(image) {}
+
+    cv::Size size() const { return m_image.size(); }
+    int type() const { return m_image.type(); }
+    cv::Mat read(const cv::Rect &roi) const { return m_image(roi); }
+    cv::Mat decoded() const { return m_image; }
+
+private:
+    cv::Mat m_image;
+};
+
+// Mapped file whose rows lie back to back: raw, PGM, TIFF with its strips in order.
+class RowSource : public ImageSource
+{
+public:
+    RowSource(cv::Ptr<MappedFile> file, size_t offset, cv::Size size, int type) :
+        m_file(file), m_offset(offset), m_size(size), m_type(type),
+        m_step((size_t)size.width * CV_ELEM_SIZE(type)) {}
+
+    cv::Size size() const { return m_size; }
+    int type() const { return m_type; }
+
+    cv::Mat read(const cv::Rect &roi) const
+    {
+        CV_Assert((roi & cv::Rect(cv::Point(), m_size)) == roi);
+        const uchar *p = m_file->data() + m_offset + (size_t)roi.y * m_step + (size_t)roi.x * CV_ELEM_SIZE(m_type);
+        return cv::Mat(roi.height, roi.width, m_type, (void*)p, m_step);
+    }
+
+private:
+    cv::Ptr<MappedFile> m_file;
+    size_t m_offset;    //first pixel
+    cv::Size m_size;
+    int m_type;
+    size_t m_step;      //bytes per row
+};
+
+// Mapped TIFF made of tiles, or of strips out of order, which are tiles as
+// wide as the image. Tiles are stored whole, right and bottom ones padded;
+// a strip at the bottom may be shorter.
+class TileSource : public ImageSource
+{
+public:
+    TileSource(cv::Ptr<MappedFile> file, cv::Size size, int type, cv::Size tile, const std::vector<size_t> &offsets) :
+        m_file(file), m_size(size), m_type(type), m_tile(tile), m_offsets(offsets),
+        m_across((size.width + tile.width-1) / tile.width) {}
+
+    cv::Size size() const { return m_size; }
+    int type() const { return m_type; }
+
+    cv::Mat read(const cv::Rect &roi) const
+    {
+        CV_Assert((roi & cv::Rect(cv::Point(), m_size)) == roi);
+        if(roi.area() == 0)
+            return cv::Mat();
+        int tx0 = roi.x / m_tile.width, tx1 = (roi.x + roi.width-1) / m_tile.width;
+        int ty0 = roi.y / m_tile.height, ty1 = (roi.y + roi.height-1) / m_tile.height;
+        if(tx0 == tx1 && ty0 == ty1)    //inside one tile, no copy
+            return tile(tx0, ty0)(roi - cv::Point(tx0*m_tile.width, ty0*m_tile.height));
+
+        cv::Mat out(roi.size(), m_type);
+        for(int ty = ty0; ty <= ty1; ty++){
+            for(int tx = tx0; tx <= tx1; tx++){
+                cv::Rect t(cv::Point(tx*m_tile.width, ty*m_tile.height), m_tile);
+                cv::Rect part = t & roi;
+                tile(tx, ty)(part - t.tl()).copyTo(out(part - roi.tl()));
+            }
+        }
+        return out;
+    }
+
+private:
+    cv::Mat tile(int tx, int ty) const
+    {
+        int rows = std::min(m_tile.height, m_size.height - ty*m_tile.height);
+        const uchar *p = m_file->data() + m_offsets[(size_t)ty*m_across + tx];
+        return cv::Mat(rows, m_tile.width, m_type, (void*)p, (size_t)m_tile.width * CV_ELEM_SIZE(m_type));
+    }
+
+    cv::Ptr<MappedFile> m_file;
+    cv::Size m_size;
+    int m_type;
+    cv::Size m_tile;
+    std::vector<size_t> m_offsets;  //row by row
+    int m_across;
+};
+
+void setError(std::string *error, const std::string &message)
+{
+    if(error)
+        *error = message;
+}
+
+// "bytes" from "offset" on lie inside the file
+bool fits(const MappedFile &file, uint64 offset, uint64 bytes)
+{
+    return offset <= file.size() && bytes <= file.size() - offset;
+}
+
+bool isSpace(uchar c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Binary PGM, "P5 width height maxval" then the pixels; 8 bits only.
+cv::Ptr<ImageSource> mapPgm(const cv::Ptr<MappedFile> &file)
+{
+    const uchar *p = file->data();
+    size_t size = file->size(), at = 2;
+    int fields[3];
+    for(int i = 0; i < 3; i++){
+        while(at < size && (isSpace(p[at]) || p[at] == '#')){
+            if(p[at] == '#')
+                while(at < size && p[at] != '\n')
+                    at++;
+            else
+                at++;
+        }
+        long long value = 0;
+        size_t from = at;
+        while(at < size && p[at] >= '0' && p[at] <= '9' && value <= (1 << 30))
+            value = value*10 + (p[at++] - '0');
+        if(at == from || value <= 0 || value > (1 << 30))
+            return cv::Ptr<ImageSource>();
+        fields[i] = (int)value;
+    }
+    if(at >= size || !isSpace(p[at]) || fields[2] > 255)
+        return cv::Ptr<ImageSource>();     //16-bit samples are decoded by imread
+    at++;   //exactly one whitespace before the pixels
+
+    cv::Size imageSize(fields[0], fields[1]);
+    if(!fits(*file, at, (uint64)imageSize.width * imageSize.height))
+        return cv::Ptr<ImageSource>();
+    return cv::makePtr<RowSource>(file, at, imageSize, CV_8UC1);
+}
+
+// TIFF header, IFD and tag values, in the file's byte order.
+struct Tiff
+{
+    const MappedFile *file;
+    bool little;
+    bool big;       // BigTIFF, 64-bit offsets and counts
+
+    uint64 get(uint64 at, int bytes) const
+    {
+        const uchar *p = file->data() + at;
+        uint64 value = 0;
+        for(int i = 0; i < bytes; i++)
+            value |= (uint64)p[little ? i : bytes-1-i] << (8*i);
+        return value;
+    }
+
+    // integer values of the IFD entry at "entry"
+    bool values(uint64 entry, std::vector<uint64> &out) const
+    {
+        int type = (int)get(entry+2, 2);
+        uint64 count = get(entry+4, big ? 8 : 4);
+        int bytes = (type == 1) ? 1 : (type == 3) ? 2 : (type == 4) ? 4 : (type == 16) ? 8 : 0;   //BYTE, SHORT, LONG, LONG8
+        if(bytes == 0 || count == 0 || count > (1u << 28))
+            return false;
+        uint64 at = entry + (big ? 12 : 8);
+        if(count*bytes > (uint64)(big ? 8 : 4))     //too big to sit in the entry itself
+            at = get(at, big ? 8 : 4);
+        if(!fits(*file, at, count*bytes))
+            return false;
+        out.resize((size_t)count);
+        for(uint64 i = 0; i < count; i++)
+            out[(size_t)i] = get(at + i*bytes, bytes);
+        return true;
+    }
+};
+
+// First image of a TIFF, when it is uncompressed grey in a type the
+// measurement takes as it is. Multi-byte samples are mapped in
+// little-endian ("II") files only, the byte order of the machines this
+// runs on; big-endian ones are swapped by imread.
+cv::Ptr<ImageSource> mapTiff(const cv::Ptr<MappedFile> &file)
+{
+    cv::Ptr<ImageSource> none;
+    if(file->size() < 16)
+        return none;
+    Tiff t;
+    t.file = file.get();
+    t.little = file->data()[0] == 'I';
+    int version = (int)t.get(2, 2);
+    if(version != 42 && version != 43)
+        return none;
+    t.big = (version == 43);
+    uint64 ifd = t.big ? t.get(8, 8) : t.get(4, 4);
+    int countBytes = t.big ? 8 : 2, entryBytes = t.big ? 20 : 12;
+    if(!fits(*file, ifd, countBytes))
+        return none;
+    uint64 entries = t.get(ifd, countBytes);
+    if(entries > 4096 || !fits(*file, ifd + countBytes, entries*entryBytes))
+        return none;
+
+    //tags this reader needs, with their defaults
+    uint64 width = 0, height = 0, bits = 1, compression = 1, photometric = 2, samples = 1, format = 1;
+    uint64 tileWidth = 0, tileHeight = 0, rowsPerStrip = ~(uint64)0;
+    std::vector<uint64> offsets;
+    for(uint64 e = 0; e < entries; e++){
+        uint64 entry = ifd + countBytes + e*entryBytes;
+        int tag = (int)t.get(entry, 2);
+        std::vector<uint64> v;
+        switch(tag){
+        case 256: case 257: case 258: case 259: case 262: case 277:
+        case 278: case 322: case 323: case 273: case 324: case 339:
+            if(!t.values(entry, v))
+                return none;
+            break;
+        default:
+            continue;
+        }
+        switch(tag){
+        case 256: width = v[0]; break;
+        case 257: height = v[0]; break;
+        case 258: bits = v[0]; break;
+        case 259: compression = v[0]; break;
+        case 262: photometric = v[0]; break;
+        case 277: samples = v[0]; break;
+        case 278: rowsPerStrip = v[0]; break;
+        case 322: tileWidth = v[0]; break;
+        case 323: tileHeight = v[0]; break;
+        case 339: format = v[0]; break;                 //1 unsigned, 3 float
+        case 273: case 324: offsets.swap(v); break;    //strip or tile offsets
+        }
+    }
+    //anything else, white-is-zero included, is left to imread
+    if(compression != 1 || photometric != 1 || samples != 1)
+        return none;
+    int type;
+    if(bits == 8 && format == 1)
+        type = CV_8UC1;
+    else if(bits == 16 && format == 1 && t.little)
+        type = CV_16UC1;
+    else if(bits == 32 && format == 3 && t.little)
+        type = CV_32FC1;
+    else
+        return none;
+    uint64 elem = bits / 8;
+    if(width == 0 || height == 0 || width > (1u << 30) || height > (1u << 30))
+        return none;
+
+    cv::Size size((int)width, (int)height);
+    cv::Size tile;
+    if(tileWidth > 0 && tileHeight > 0){
+        if(tileWidth > width*16 || tileHeight > height*16)
+            return none;
+        tile = cv::Size((int)tileWidth, (int)tileHeight);
+    }
+    else{
+        tile = cv::Size(size.width, (int)std::min(std::max(rowsPerStrip, (uint64)1), height));
+    }
+
+    uint64 across = (width + tile.width-1) / tile.width, down = (height + tile.height-1) / tile.height;
+    if(offsets.size() != across*down)
+        return none;
+    std::vector<size_t> blocks(offsets.size());
+    bool inOrder = (tileWidth == 0);
+    for(size_t i = 0; i < offsets.size(); i++){
+        uint64 rows = std::min((uint64)tile.height, height - (i / across) * tile.height);
+        if(!fits(*file, offsets[i], (tileWidth ? (uint64)tile.height : rows) * tile.width * elem))
+            return none;
+        blocks[i] = (size_t)offsets[i];
+        inOrder = inOrder && offsets[i] == offsets[0] + i * (uint64)tile.height * width * elem;
+    }
+    if(inOrder)     //one run of rows, like a raw frame
+        return cv::makePtr<RowSource>(file, blocks[0], size, type);
+    return cv::makePtr<TileSource>(file, size, type, tile, blocks);
+}
+
+// every factor-th pixel of "row"
+template<typename P>
+void decimateRow(const cv::Mat &row, cv::Mat &out, int factor)
+{
+    const P *src = row.ptr<P>(0);
+    P *dst = out.ptr<P>(0);
+    for(int x = 0; x < out.cols; x++)
+        dst[x] = src[x*factor];
+}
+
+} // namespace
+
+cv::Ptr<ImageSource> openImageSource(const std::string &path, std::string *error)
+{
+    cv::Ptr<MappedFile> file = cv::makePtr<MappedFile>();
+    if(file->open(path) && file->size() >= 4){
+        const uchar *p = file->data();
+        cv::Ptr<ImageSource> mapped;
+        if(p[0] == 'P' && p[1] == '5')
+            mapped = mapPgm(file);
+        else if((p[0] == 'I' && p[1] == 'I') || (p[0] == 'M' && p[1] == 'M'))
+            mapped = mapTiff(file);
+        if(mapped)
+            return mapped;
+    }
+    file.release();
+
+    cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE | cv::IMREAD_ANYDEPTH);
+    if(image.empty()){
+        setError(error, "cannot read " + path + " as an image");
+        return cv::Ptr<ImageSource>();
+    }
+    if(image.depth() != CV_8U && image.depth() != CV_16U && image.depth() != CV_32F)
+        image.convertTo(image, CV_32F);     //signed and double samples
+    return cv::makePtr<MemorySource>(image);
+}
+
+cv::Ptr<ImageSource> openRawImageSource(const std::string &path, const RawFormat &format, std::string *error)
+{
+    cv::Size size = format.size;
+    if(size.width <= 0 || size.height <= 0){
+        setError(error, "raw frame size of " + path + " is not set");
+        return cv::Ptr<ImageSource>();
+    }
+    cv::Ptr<MappedFile> file = cv::makePtr<MappedFile>();
+    if(!file->open(path)){
+        setError(error, "cannot open " + path);
+        return cv::Ptr<ImageSource>();
+    }
+    CV_Assert(format.type == CV_8UC1 || format.type == CV_16UC1);
+    if(!fits(*file, format.header, (uint64)size.width * size.height * CV_ELEM_SIZE(format.type))){
+        setError(error, path + " is too short for the raw frame size");
+        return cv::Ptr<ImageSource>();
+    }
+    return cv::makePtr<RowSource>(file, format.header, size, format.type);
+}
+
+bool parseRawFormat(const std::string &text, RawFormat &format)
+{
+    int width = 0, height = 0, bits = 8, used = 0;
+    if(std::sscanf(text.c_str(), "%dx%d%n", &width, &height, &used) != 2 || width <= 0 || height <= 0)
+        return false;
+    const char *rest = text.c_str() + used;
+    if(rest[0] == 'x'){
+        char *end = 0;
+        bits = (int)std::strtol(rest + 1, &end, 10);
+        if(end == rest + 1 || (bits != 8 && bits != 16))
+            return false;
+        rest = end;
+    }
+    size_t offset = 0;
+    if(rest[0] == '+'){
+        char *end = 0;
+        offset = (size_t)std::strtoull(rest + 1, &end, 10);
+        if(end == rest + 1)
+            return false;
+        rest = end;
+    }
+    if(rest[0] != '\0')
+        return false;
+    format.size = cv::Size(width, height);
+    format.type = (bits == 16) ? CV_16UC1 : CV_8UC1;
+    format.header = offset;
+    return true;
+}
+
+cv::Mat imageOverview(const ImageSource &source, int maxSide, int &factor)
+{
+    cv::Size size = source.size();
+    factor = 1;
+    while((size.width + factor-1) / factor > maxSide || (size.height + factor-1) / factor > maxSide)
+        factor *= 2;
+
+    int type = source.type();
+    cv::Mat overview((size.height + factor-1) / factor, (size.width + factor-1) / factor, type);
+    cv::parallel_for_(cv::Range(0, overview.rows), [&](const cv::Range &range){
+        for(int y = range.start; y < range.end; y++){
+            cv::Mat row = source.read(cv::Rect(0, y*factor, size.width, 1));
+            cv::Mat out = overview.row(y);
+            switch(CV_ELEM_SIZE(type)){     //pixels are only copied, the size is all that matters
+            case 1: decimateRow<uchar>(row, out, factor); break;
+            case 2: decimateRow<ushort>(row, out, factor); break;
+            default: decimateRow<int>(row, out, factor); break;
+            }
+        }
+    });
+    return overview;
+}
@@ -0,0 +1,69 @@
+#ifndef IMAGESOURCE_H
+#define IMAGESOURCE_H
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+// Where the pixels of an image come from. A file whose pixels can be used
+// as they lie on disk is memory mapped: 8-bit binary PGM, headerless 8- or
+// 16-bit raw frames and uncompressed grey TIFF, striped or tiled, classic
+// or BigTIFF, 8-bit, or 16-bit and 32-bit float in little-endian order.
+// Opening one reads its header only, and the system loads just the pages
+// under the pixels that are read, so a multi-gigabyte line-scan frame costs
+// the region a measurement covers, not the file size. Any other file is
+// decoded into memory by cv::imread, keeping its depth: 8-bit, 16-bit and
+// float images stay as they are, other depths are converted to float.
+//
+// Sources are read only and safe to read from several threads; a matrix
+// read from one is valid as long as the source.
+class ImageSource
+{
+public:
+    virtual ~ImageSource() {}
+
+    virtual cv::Size size() const = 0;
+
+    // CV_8UC1, CV_16UC1 or CV_32FC1
+    virtual int type() const = 0;
+
+    // Pixels of "roi", which must lie inside the image. A view into
+    // the mapping or the decoded image when its rows are contiguous there,
+    // otherwise a copy gathered from the tiles under it. Never written to.
+    virtual cv::Mat read(const cv::Rect &roi) const = 0;
+
+    // The whole image when it was decoded into memory, empty for a mapped file.
+    virtual cv::Mat decoded() const { return cv::Mat(); }
+};
+
+// Maps PGM and TIFF files in one of the layouts above, decodes every other
+// file, compressed TIFF included, with cv::imread. Empty with a message in
+// "error" when the file is neither.
+cv::Ptr<ImageSource> openImageSource(const std::string &path, std::string *error = 0);
+
+// Layout of a headerless frame: rows back to back after "header" bytes,
+// 16-bit samples little-endian.
+struct RawFormat
+{
+    RawFormat() : type(CV_8UC1), header(0) {}
+
+    cv::Size size;
+    int type;           // CV_8UC1 or CV_16UC1
+    size_t header;
+};
+
+cv::Ptr<ImageSource> openRawImageSource(const std::string &path, const RawFormat &format,
+                                        std::string *error = 0);
+
+// "WIDTHxHEIGHT", then "x16" for 16-bit samples, then "+HEADER", the raw
+// frame layout as the command line and the dialog take it.
+bool parseRawFormat(const std::string &text, RawFormat &format);
+
+// Reduced copy for display, of the source's type, "factor" image pixels per overview pixel, the
+// smallest power of two that brings both sides down to "maxSide". Every
+// factor-th pixel of every factor-th row is kept, so a mapped file with
+// contiguous rows is read in part only, where an area average would touch
+// every page.
+cv::Mat imageOverview(const ImageSource &source, int maxSide, int &factor);
+
+#endif // IMAGESOURCE_H
@@ -0,0 +1,443 @@
+#include "linesampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace
+{
+
+inline int clampi(int v, int high)
+{
+    return std::min(std::max(v, 0), high);
+}
+
+template<typename P>
+inline float bilinear(const cv::Mat &image, float x, float y)
+{
+    int x0 = cvFloor(x), y0 = cvFloor(y);
+    float fx = x - x0, fy = y - y0;
+    int x1 = clampi(x0+1, image.cols-1), y1 = clampi(y0+1, image.rows-1);
+    x0 = clampi(x0, image.cols-1);
+    y0 = clampi(y0, image.rows-1);
+
+    const P *r0 = image.ptr<P>(y0), *r1 = image.ptr<P>(y1);
+    float top = r0[x0] + fx*(r0[x1] - r0[x0]);
+    float bottom = r1[x0] + fx*(r1[x1] - r1[x0]);
+    return top + fy*(bottom - top);
+}
+
+// cv::remap's INTER_CUBIC coefficients
+inline void cubicWeights(float f, float w[4])
+{
+    const float A = -0.75f;
+    w[0] = ((A*(f + 1) - 5*A)*(f + 1) + 8*A)*(f + 1) - 4*A;
+    w[1] = ((A + 2)*f - (A + 3))*f*f + 1;
+    w[2] = ((A + 2)*(1 - f) - (A + 3))*(1 - f)*(1 - f) + 1;
+    w[3] = 1 - w[0] - w[1] - w[2];
+}
+
+// cubic overshoot is clipped to the values the pixel type holds, as
+// cv::remap saturates; float pixels are left as they come
+template<typename P> inline float clipCubic(float v) { return v; }
+template<> inline float clipCubic<uchar>(float v) { return std::min(std::max(v, 0.f), 255.f); }
+template<> inline float clipCubic<ushort>(float v) { return std::min(std::max(v, 0.f), 65535.f); }
+
+template<typename P>
+inline float bicubic(const cv::Mat &image, float x, float y)
+{
+    int x0 = cvFloor(x), y0 = cvFloor(y);
+    float wx[4], wy[4];
+    cubicWeights(x - x0, wx);
+    cubicWeights(y - y0, wy);
+
+    int xs[4];
+    for(int k = 0; k < 4; k++)
+        xs[k] = clampi(x0 - 1 + k, image.cols-1);
+
+    float sum = 0;
+    for(int j = 0; j < 4; j++){
+        const P *row = image.ptr<P>(clampi(y0 - 1 + j, image.rows-1));
+        sum += wy[j]*(wx[0]*row[xs[0]] + wx[1]*row[xs[1]] + wx[2]*row[xs[2]] + wx[3]*row[xs[3]]);
+    }
+    return clipCubic<P>(sum);
+}
+
+} // namespace
+
+int lineSampleCount(cv::Point2f a, cv::Point2f b, double step)
+{
+    double L = std::sqrt((double)(b.x-a.x)*(b.x-a.x) + (double)(b.y-a.y)*(b.y-a.y));
+    return (int)std::floor(L / step + 1e-9) + 1;
+}
+
+cv::Point2f lineDelta(cv::Point2f a, cv::Point2f b, double step)
+{
+    double L = std::sqrt((double)(b.x-a.x)*(b.x-a.x) + (double)(b.y-a.y)*(b.y-a.y));
+    if(L == 0)
+        return cv::Point2f(0, 0);
+    return cv::Point2f((float)((b.x-a.x) * step / L), (float)((b.y-a.y) * step / L));
+}
+
+void linePositions(cv::Point2f start, cv::Point2f delta, int count, std::vector<cv::Point2f> &points)
+{
+    points.resize(count);
+    for(int i = 0; i < count; i++)
+        points[i] = cv::Point2f(start.x + i*delta.x, start.y + i*delta.y);
+}
+
+namespace
+{
+
+#if CV_SIMD128
+// what the vector bilinear loop reads pixels of type P into: integers are
+// widened to int and converted four at a time, floats are used as they are
+template<typename P>
+struct Gathered
+{
+    typedef int type;
+    static cv::v_float32x4 load(const int *p) { return cv::v_cvt_f32(cv::v_load(p)); }
+};
+
+template<>
+struct Gathered<float>
+{
+    typedef float type;
+    static cv::v_float32x4 load(const float *p) { return cv::v_load(p); }
+};
+#endif
+
+// the sampling loop for pixels of type P, writing floats for the strip
+// buffer or doubles for a profile
+template<typename P, typename T>
+void sampleRow(const cv::Mat &image, cv::Point2f start, cv::Point2f delta, int count,
+               int interpolation, T *out)
+{
+    int i = 0;
+    if(interpolation == cv::INTER_CUBIC){
+        for(; i < count; i++)
+            out[i] = bicubic<P>(image, start.x + i*delta.x, start.y + i*delta.y);
+        return;
+    }
+
+#if CV_SIMD128
+    //four samples at a time: positions, corner indexes and weights in
+    //registers, only the 16 pixel reads are scalar (SSE2/NEON have no gather);
+    //integer pixels are converted to float four at a time after the reads
+    typedef typename Gathered<P>::type G;
+    const uchar *data = image.data;
+    size_t stride = image.step;
+    cv::v_float32x4 vidx(0.f, 1.f, 2.f, 3.f);
+    cv::v_float32x4 vsx = cv::v_setall_f32(start.x), vsy = cv::v_setall_f32(start.y);
+    cv::v_float32x4 vdx = cv::v_setall_f32(delta.x), vdy = cv::v_setall_f32(delta.y);
+    cv::v_int32x4 vzero = cv::v_setzero_s32(), vone = cv::v_setall_s32(1);
+    cv::v_int32x4 vmaxX = cv::v_setall_s32(image.cols-1), vmaxY = cv::v_setall_s32(image.rows-1);
+
+    int ix0[4], ix1[4], iy0[4], iy1[4];
+    G p00[4], p01[4], p10[4], p11[4];
+    float result[4];
+    for(; i <= count-4; i += 4){
+        cv::v_float32x4 t = vidx + cv::v_setall_f32((float)i);
+        cv::v_float32x4 x = t*vdx + vsx, y = t*vdy + vsy;
+        cv::v_int32x4 x0 = cv::v_floor(x), y0 = cv::v_floor(y);
+        cv::v_float32x4 fx = x - cv::v_cvt_f32(x0), fy = y - cv::v_cvt_f32(y0);
+
+        cv::v_store(ix1, cv::v_min(cv::v_max(x0 + vone, vzero), vmaxX));
+        cv::v_store(iy1, cv::v_min(cv::v_max(y0 + vone, vzero), vmaxY));
+        cv::v_store(ix0, cv::v_min(cv::v_max(x0, vzero), vmaxX));
+        cv::v_store(iy0, cv::v_min(cv::v_max(y0, vzero), vmaxY));
+
+        for(int k = 0; k < 4; k++){
+            const P *r0 = (const P*)(data + iy0[k]*stride), *r1 = (const P*)(data + iy1[k]*stride);
+            p00[k] = r0[ix0[k]];
+            p01[k] = r0[ix1[k]];
+            p10[k] = r1[ix0[k]];
+            p11[k] = r1[ix1[k]];
+        }
+
+        cv::v_float32x4 v00 = Gathered<P>::load(p00), v10 = Gathered<P>::load(p10);
+        cv::v_float32x4 top = v00 + fx*(Gathered<P>::load(p01) - v00);
+        cv::v_float32x4 bottom = v10 + fx*(Gathered<P>::load(p11) - v10);
+        cv::v_store(result, top + fy*(bottom - top));
+        for(int k = 0; k < 4; k++)
+            out[i+k] = result[k];
+    }
+#endif
+    for(; i < count; i++)
+        out[i] = bilinear<P>(image, start.x + i*delta.x, start.y + i*delta.y);
+}
+
+// The instance of sampleRow for an image depth, picked once per call so
+// the loops themselves never branch on the pixel type.
+template<typename T>
+struct RowSampler
+{
+    typedef void (*Function)(const cv::Mat&, cv::Point2f, cv::Point2f, int, int, T*);
+
+    static Function forDepth(int depth)
+    {
+        switch(depth){
+        case CV_8U:  return sampleRow<uchar,T>;
+        case CV_16U: return sampleRow<ushort,T>;
+        default:     return sampleRow<float,T>;
+        }
+    }
+};
+
+} // namespace
+
+bool samplerType(int type)
+{
+    return type == CV_8UC1 || type == CV_16UC1 || type == CV_32FC1;
+}
+
+void sampleLine(const cv::Mat &image, cv::Point2f start, cv::Point2f delta, int count,
+                int interpolation, double *out)
+{
+    CV_Assert(samplerType(image.type()));
+    CV_Assert(interpolation == cv::INTER_LINEAR || interpolation == cv::INTER_CUBIC);
+    RowSampler<double>::forDepth(image.depth())(image, start, delta, count, interpolation, out);
+}
+
+namespace
+{
+
+// samples per block of the strip and batched samplers: a block of every
+// line covers a compact patch of the image that stays in cache while all
+// lines read it, and a strip block stays in cache until it is reduced
+const int batchBlock = 256;
+
+// widest strip whose median goes through the selection network; wider
+// ones take nth_element, which grows linearly
+const int networkMaxWidth = 128;
+
+} // namespace
+
+StripReducer::StripReducer(int width, bool median) :
+    m_width(std::max(width, 1)),
+    m_median(median && width > 1)
+{
+#if CV_SIMD128
+    if(!m_median || m_width > networkMaxWidth)
+        return;
+
+    //Batcher's odd-even merge sort of the next power of two; comparators
+    //that touch the padding (+infinity, it never moves down) are dropped
+    int n = m_width, N = 1;
+    while(N < n)
+        N *= 2;
+    std::vector< std::pair<int,int> > sort;
+    for(int p = 1; p < N; p *= 2)
+        for(int k = p; k >= 1; k /= 2)
+            for(int j = k % p; j + k < N; j += 2*k)
+                for(int i = 0; i < std::min(k, N - j - k); i++)
+                    if((i + j) / (2*p) == (i + j + k) / (2*p) && i + j + k < n)
+                        sort.push_back(std::make_pair(i + j, i + j + k));
+
+    //only what the middle one or two outputs depend on, walking back
+    std::vector<bool> needed(n, false);
+    needed[n/2] = true;
+    if(n % 2 == 0)
+        needed[n/2 - 1] = true;
+    for(size_t c = sort.size(); c-- > 0;){
+        int a = sort[c].first, b = sort[c].second;
+        if(needed[a] || needed[b]){
+            m_network.push_back(sort[c]);
+            needed[a] = needed[b] = true;
+        }
+    }
+    std::reverse(m_network.begin(), m_network.end());
+#endif
+}
+
+void StripReducer::reduce(const float *rows, size_t stride, int count, double *out) const
+{
+    int width = m_width;
+    if(width == 1){
+        for(int i = 0; i < count; i++)
+            out[i] = rows[i];
+        return;
+    }
+
+    if(!m_median){
+        //row by row, contiguous adds
+        cv::AutoBuffer<float> buffer(count);
+        float *sum = buffer;
+        std::copy(rows, rows + count, sum);
+        for(int k = 1; k < width; k++){
+            const float *row = rows + k*stride;
+            int i = 0;
+#if CV_SIMD128
+            for(; i <= count-4; i += 4)
+                cv::v_store(sum+i, cv::v_load(sum+i) + cv::v_load(row+i));
+#endif
+            for(; i < count; i++)
+                sum[i] += row[i];
+        }
+        for(int i = 0; i < count; i++)
+            out[i] = sum[i] / width;
+        return;
+    }
+
+    //the mean of the two middle values for an even width
+    int mid = width/2;
+    int i = 0;
+#if CV_SIMD128
+    if(!m_network.empty()){
+        //four columns at a time through the network, one register per row
+        cv::AutoBuffer<cv::v_float32x4> buffer(width);
+        cv::v_float32x4 *v = buffer;
+        float low[4], high[4];
+        for(; i <= count-4; i += 4){
+            for(int k = 0; k < width; k++)
+                v[k] = cv::v_load(rows + k*stride + i);
+            for(size_t c = 0; c < m_network.size(); c++){
+                cv::v_float32x4 a = v[m_network[c].first], b = v[m_network[c].second];
+                v[m_network[c].first] = cv::v_min(a, b);
+                v[m_network[c].second] = cv::v_max(a, b);
+            }
+            cv::v_store(high, v[mid]);
+            cv::v_store(low, v[width % 2 == 0 ? mid-1 : mid]);
+            for(int k = 0; k < 4; k++)
+                out[i+k] = (width % 2 == 0) ? ((double)low[k] + high[k]) * 0.5 : high[k];
+        }
+    }
+#endif
+    cv::AutoBuffer<float> buffer(width);
+    float *column = buffer;
+    for(; i < count; i++){
+        for(int k = 0; k < width; k++)
+            column[k] = rows[k*stride + i];
+        std::nth_element(column, column + mid, column + width);
+        double value = column[mid];
+        if(width % 2 == 0)
+            value = (value + *std::max_element(column, column + mid)) * 0.5;
+        out[i] = value;
+    }
+}
+
+void sampleStrip(const cv::Mat &image, cv::Point2f start, cv::Point2f delta, cv::Point2f normal,
+                 int count, int width, int interpolation, bool median, double *out)
+{
+    CV_Assert(samplerType(image.type()));
+    CV_Assert(interpolation == cv::INTER_LINEAR || interpolation == cv::INTER_CUBIC);
+    if(width <= 1){
+        RowSampler<double>::forDepth(image.depth())(image, start, delta, count, interpolation, out);
+        return;
+    }
+
+    //block by block along the line: one row per line across the strip,
+    //each sampled by the vector loop, then reduced while still in cache
+    RowSampler<float>::Function sampleRowF = RowSampler<float>::forDepth(image.depth());
+    StripReducer reducer(width, median);
+    cv::AutoBuffer<float> strip((size_t)width*batchBlock);
+    for(int i0 = 0; i0 < count; i0 += batchBlock){
+        int n = std::min(batchBlock, count - i0);
+        for(int k = 0; k < width; k++){
+            float t = k - (width-1) * 0.5f;
+            cv::Point2f origin(start.x + t*normal.x + i0*delta.x, start.y + t*normal.y + i0*delta.y);
+            sampleRowF(image, origin, delta, n, interpolation, &strip[(size_t)k*batchBlock]);
+        }
+        reducer.reduce(strip, batchBlock, n, out + i0);
+    }
+}
+
+namespace
+{
+
+template<typename P>
+void gatherPixelLines(const cv::Mat &image, const std::vector<cv::Point> &pattern,
+                      const std::vector<cv::Point> &shifts, cv::Mat &rows)
+{
+    int count = (int)pattern.size();
+    ptrdiff_t stride = (ptrdiff_t)(image.step / sizeof(P));
+
+    //the step sequence as element offsets, computed once for every line;
+    //ptrdiff_t, a long line across a large mapped frame overflows int
+    std::vector<ptrdiff_t> offsets(count);
+    for(int i = 0; i < count; i++)
+        offsets[i] = pattern[i].y*stride + pattern[i].x;
+    cv::Rect box = cv::boundingRect(pattern);
+    cv::Rect inside(0, 0, image.cols, image.rows);
+
+    cv::parallel_for_(cv::Range(0, (int)shifts.size()), [&](const cv::Range &range){
+        for(int i0 = 0; i0 < count; i0 += batchBlock){
+            int i1 = std::min(count, i0 + batchBlock);
+            for(int n = range.start; n < range.end; n++){
+                cv::Point s = shifts[n];
+                float *out = rows.ptr<float>(n);
+                if(((box + s) & inside) == box + s){    //whole line inside: a plain gather
+                    const P *base = image.ptr<P>(s.y) + s.x;
+                    for(int i = i0; i < i1; i++)
+                        out[i] = base[offsets[i]];
+                }
+                else{
+                    for(int i = i0; i < i1; i++){
+                        int x = clampi(pattern[i].x + s.x, image.cols-1);
+                        int y = clampi(pattern[i].y + s.y, image.rows-1);
+                        out[i] = image.ptr<P>(y)[x];
+                    }
+                }
+            }
+        }
+    });
+}
+
+} // namespace
+
+void samplePixelLines(const cv::Mat &image, const std::vector<cv::Point> &pattern,
+                      const std::vector<cv::Point> &shifts, cv::Mat &rows)
+{
+    CV_Assert(samplerType(image.type()));
+
+    rows.create((int)shifts.size(), (int)pattern.size(), CV_32F);
+    if(pattern.empty() || shifts.empty())
+        return;
+
+    switch(image.depth()){
+    case CV_8U:  gatherPixelLines<uchar>(image, pattern, shifts, rows); break;
+    case CV_16U: gatherPixelLines<ushort>(image, pattern, shifts, rows); break;
+    default:     gatherPixelLines<float>(image, pattern, shifts, rows); break;
+    }
+}
+
+void sampleLines(const cv::Mat &image, cv::Point2f start, cv::Point2f delta, int count,
+                 const std::vector<cv::Point2f> &shifts, int interpolation, cv::Mat &rows)
+{
+    CV_Assert(samplerType(image.type()));
+    CV_Assert(interpolation == cv::INTER_LINEAR || interpolation == cv::INTER_CUBIC);
+
+    rows.create((int)shifts.size(), count, CV_32F);
+    if(count == 0 || shifts.empty())
+        return;
+
+    RowSampler<float>::Function sampleRowF = RowSampler<float>::forDepth(image.depth());
+    cv::parallel_for_(cv::Range(0, (int)shifts.size()), [&](const cv::Range &range){
+        for(int i0 = 0; i0 < count; i0 += batchBlock){
+            int i1 = std::min(count, i0 + batchBlock);
+            for(int n = range.start; n < range.end; n++){
+                cv::Point2f origin(start.x + shifts[n].x + i0*delta.x, start.y + shifts[n].y + i0*delta.y);
+                sampleRowF(image, origin, delta, i1 - i0, interpolation, rows.ptr<float>(n) + i0);
+            }
+        }
+    });
+}
+
+void reduceStrips(const cv::Mat &rows, int width, bool median, cv::Mat &profiles)
+{
+    CV_Assert(rows.type() == CV_32F && width >= 1 && rows.rows % width == 0);
+
+    int lines = rows.rows / width, count = rows.cols;
+    profiles.create(lines, count, CV_64F);
+    size_t stride = rows.step / sizeof(float);
+
+    StripReducer reducer(width, median);
+    cv::parallel_for_(cv::Range(0, lines), [&](const cv::Range &range){
+        for(int n = range.start; n < range.end; n++)
+            reducer.reduce(rows.ptr<float>(n*width), stride, count, profiles.ptr<double>(n));
+    });
+}
@@ -0,0 +1,77 @@
+#ifndef LINESAMPLER_H
+#define LINESAMPLER_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// Sub-pixel sampling along a straight line. Samples sit a fixed distance
+// apart whatever the line's angle, unlike the 8-connected pixels of
+// cv::LineIterator, which are 1 pixel apart on a horizontal line and
+// up to 1.41 on a diagonal one.
+
+// Number of samples "step" pixels apart from a to b, a included:
+// floor(|ab| / step) + 1.
+int lineSampleCount(cv::Point2f a, cv::Point2f b, double step);
+
+// Positions a + i*delta for i = 0..count-1, delta = step along a->b.
+cv::Point2f lineDelta(cv::Point2f a, cv::Point2f b, double step);
+void linePositions(cv::Point2f start, cv::Point2f delta, int count, std::vector<cv::Point2f> &points);
+
+// Pixel types every sampler takes: CV_8UC1, CV_16UC1 and CV_32FC1. The
+// loops are compiled once per type and the instance is picked once per
+// call, so a 12 or 16-bit image keeps its full range into the profile.
+bool samplerType(int type);
+
+// Values of the image at start + i*delta, i = 0..count-1, written to
+// out[0..count-1]. "interpolation" is cv::INTER_LINEAR or cv::INTER_CUBIC
+// (the a = -0.75 kernel cv::remap uses, clipped to the range of the pixel
+// type). Pixels outside the image repeat the border, like BORDER_REPLICATE.
+void sampleLine(const cv::Mat &image, cv::Point2f start, cv::Point2f delta, int count,
+                int interpolation, double *out);
+
+// Strip of "width" lines one pixel apart, centred on the line and spread
+// along the unit "normal". Each output sample is the mean, or the median,
+// of the "width" values across the strip at that position; noise is
+// averaged out across the line without blurring along it.
+void sampleStrip(const cv::Mat &image, cv::Point2f start, cv::Point2f delta, cv::Point2f normal,
+                 int count, int width, int interpolation, bool median, double *out);
+
+// Batched sampling of lines that are translations of one line, such as
+// the parallel offset lines: row n of "rows" (CV_32F, one row per shift,
+// one column per sample) holds the samples of the line moved by shifts[n].
+// The step sequence is computed once for all of them and the lines are
+// read together, block by block along their length, so at high line
+// counts the cost is the pixel reads alone.
+//
+// Pixel steps: "pattern" holds the pixels of the line relative to its
+// start (cv::LineIterator positions minus the start point).
+void samplePixelLines(const cv::Mat &image, const std::vector<cv::Point> &pattern,
+                      const std::vector<cv::Point> &shifts, cv::Mat &rows);
+
+// Interpolated: start + shifts[n] + i*delta, i = 0..count-1.
+void sampleLines(const cv::Mat &image, cv::Point2f start, cv::Point2f delta, int count,
+                 const std::vector<cv::Point2f> &shifts, int interpolation, cv::Mat &rows);
+
+// Mean or median of each column of a strip: "width" float rows "stride"
+// floats apart, one output per column. The median of a strip up to 128
+// wide goes through a selection network four columns at a time (vector
+// min/max, no sort), built once here for the width.
+class StripReducer
+{
+public:
+    StripReducer(int width, bool median);
+
+    void reduce(const float *rows, size_t stride, int count, double *out) const;
+
+private:
+    int m_width;
+    bool m_median;
+    std::vector< std::pair<int,int> > m_network;
+};
+
+// Combines every "width" consecutive rows, the strip of one line, into one
+// CV_64F profile row by the mean or the median of each column.
+void reduceStrips(const cv::Mat &rows, int width, bool median, cv::Mat &profiles);
+
+#endif // LINESAMPLER_H
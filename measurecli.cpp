@@ -0,0 +1,280 @@
+// Batch measurement without the dialog: the same AB line, offset lines or
+// rays are measured on every image matching a glob, one image per core.
+//
+//   measurecli "parts/*.png" --a=120,200 --b=480,210 --kernel=7 --amplitude=12 \
+//              --offset-num=5 --offset-val=10
+//   measurecli "parts/*.png" --a=300,300 --b=420,300 --rays=35 --degree=10
+//   measurecli "parts/*.png" --recipe=part7.yml
+//
+// A recipe saved by the dialog replaces every measurement option.
+//
+// PGM, uncompressed TIFF and headerless raw frames (--raw=16384x65536, or
+// --raw=4096x4096x16 for 16-bit ones) are memory mapped, see imagesource.h:
+// only the pixels around the lines are ever read, whatever the size of the
+// frame. 16-bit and float images are measured at their full depth; the
+// amplitude stays in 8-bit grey levels, --bits tells a 12-bit sensor's range.
+//
+// One CSV record per image goes to stdout as soon as it is measured, the
+// throughput and the time per stage go to stderr at the end. --out appends
+// every edge point and fit to a file as well, see resultsink.h.
+
+#include "measurecore.h"
+#include "imagesource.h"
+#include "measurerecipe.h"
+#include "resultsink.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/utility.hpp>
+
+namespace
+{
+
+const char *keys =
+        "{help h usage ? |       | print this message }"
+        "{@images        |       | image path glob, e.g. \"parts/*.png\" }"
+        "{recipe         |       | recipe file saved by the dialog, replaces the options below }"
+        "{a              |       | A end point of the line, x,y }"
+        "{b              |       | B end point of the line, x,y }"
+        "{kernel         | 5     | Gaussian kernel size, odd }"
+        "{amplitude      | 12    | persistence threshold of the peaks, in 8-bit grey levels }"
+        "{bits           | 0     | significant bits of 16-bit images, e.g. 12, 0 = all 16 }"
+        "{offset-num     | 0     | parallel lines on each side of AB }"
+        "{offset-val     | 5     | pixels between parallel lines }"
+        "{rays           | 0     | rays after AB, measures a circle instead of a line }"
+        "{degree         | 1     | degrees between rays, down to 0.1 }"
+        "{slope          | 2     | edge type that is fitted, 1 = up slope, 2 = down slope }"
+        "{recursive      |       | smooth with the recursive Gaussian }"
+        "{analytic       |       | analytic steepest slope instead of resampling }"
+        "{width          | 1     | strip across the line each sample integrates, 1 to 64 pixels }"
+        "{median         |       | median across the strip instead of the mean }"
+        "{sampling       | pixel | pixel (8-connected steps), bilinear or bicubic }"
+        "{step           | 1     | pixels between bilinear or bicubic samples }"
+        "{raw            |       | the images are headerless frames, WIDTHxHEIGHT[x16][+HEADER], x16 for 16-bit little-endian samples }"
+        "{out            |       | append edge points and fits here, .csv or columnar for any other name }"
+        "{threads        | -1    | worker threads, -1 = all cores }";
+
+bool parsePoint(const std::string &text, cv::Point2f &p)
+{
+    return std::sscanf(text.c_str(), "%f,%f", &p.x, &p.y) == 2;
+}
+
+// summed over every worker
+struct Totals
+{
+    Totals() : read(0), fit(0), write(0), images(0), failed(0) {}
+
+    MeasureTiming measure;
+    double read,fit,write;
+    int images,failed;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("Measures the same line or circle on a folder of images.");
+    bool useRecipe = parser.has("recipe");
+    if(parser.has("help") || !parser.has("@images") || (!useRecipe && (!parser.has("a") || !parser.has("b")))){
+        parser.printMessage();
+        return parser.has("help") ? 0 : 1;
+    }
+
+    MeasureParams params;
+    int slopeType;
+    if(useRecipe){
+        MeasureRecipe recipe;
+        std::string error;
+        if(!loadRecipe(parser.get<std::string>("recipe"), recipe, &error)){
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        params = recipe.params;
+        slopeType = recipe.slopeType;
+    }
+    else{
+        if(!parsePoint(parser.get<std::string>("a"), params.a) || !parsePoint(parser.get<std::string>("b"), params.b)){
+            std::fprintf(stderr, "--a and --b take x,y\n");
+            return 1;
+        }
+        params.kernel = parser.get<int>("kernel");
+        if(params.kernel < 1 || params.kernel > 255 || params.kernel%2 == 0){
+            std::fprintf(stderr, "--kernel takes an odd size, 1 to 255\n");
+            return 1;
+        }
+        params.amplitude = parser.get<int>("amplitude");
+        params.bitDepth = parser.get<int>("bits");
+        if(params.bitDepth != 0 && (params.bitDepth < 9 || params.bitDepth > 16)){
+            std::fprintf(stderr, "--bits takes 9 to 16, or 0\n");
+            return 1;
+        }
+        params.backend = parser.has("recursive") ? BlurCache::Recursive : BlurCache::Gaussian;
+        params.analytic = parser.has("analytic");
+        params.width = parser.get<int>("width");
+        if(params.width < 1 || params.width > 64){
+            std::fprintf(stderr, "--width takes 1 to 64\n");
+            return 1;
+        }
+        params.stripMedian = parser.has("median");
+        std::string sampling = parser.get<std::string>("sampling");
+        if(sampling == "bilinear")
+            params.sampling = MeasureParams::Bilinear;
+        else if(sampling == "bicubic")
+            params.sampling = MeasureParams::Bicubic;
+        else if(sampling != "pixel"){
+            std::fprintf(stderr, "--sampling takes pixel, bilinear or bicubic\n");
+            return 1;
+        }
+        params.step = parser.get<double>("step");
+        if(params.step <= 0){
+            std::fprintf(stderr, "--step must be > 0\n");
+            return 1;
+        }
+        if(parser.get<int>("rays") > 0){
+            params.offsets = MeasureParams::Rays;
+            params.offsetNum = parser.get<int>("rays");
+            params.rayDegree = parser.get<double>("degree");
+        }
+        else{
+            params.offsets = MeasureParams::ParallelLines;
+            params.offsetNum = parser.get<int>("offset-num");
+            params.offsetVal = parser.get<int>("offset-val");
+        }
+        slopeType = parser.get<int>("slope");
+    }
+    params.stage = MeasureParams::Edges;
+    params.roiSmooth = true;    //only the measured area is ever read
+    std::string pattern = parser.get<std::string>("@images");
+    if(!parser.check()){
+        parser.printErrors();
+        return 1;
+    }
+
+    RawFormat rawFormat;
+    bool raw = parser.has("raw");
+    if(raw && !parseRawFormat(parser.get<std::string>("raw"), rawFormat)){
+        std::fprintf(stderr, "--raw takes WIDTHxHEIGHT[x16][+HEADER]\n");
+        return 1;
+    }
+
+    cv::Ptr<ResultSink> sink;
+    if(parser.has("out")){
+        std::string error;
+        sink = openResultSink(parser.get<std::string>("out"), &error);
+        if(!sink){
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    if(parser.get<int>("threads") > 0)
+        cv::setNumThreads(parser.get<int>("threads"));
+
+    std::vector<cv::String> files;
+    cv::glob(pattern, files, false);
+    if(files.empty()){
+        std::fprintf(stderr, "no image matches %s\n", pattern.c_str());
+        return 1;
+    }
+
+    std::printf("index,image,status,main_edges,lines,fitted,x1,y1,x2,y2,cx,cy,r\n");
+
+    Totals totals;
+    cv::Mutex lock;     //guards stdout, the sink and totals
+    cv::TickMeter wall;
+    wall.start();
+
+    //images are independent: one per worker, the per-line loops inside
+    //measure() then run inline on that worker
+    cv::parallel_for_(cv::Range(0,(int)files.size()), [&](const cv::Range &range){
+        MeasureCore core;
+        for(int i = range.start ; i < range.end ; i++){
+            int64 start = cv::getTickCount();
+            cv::Ptr<ImageSource> source = raw ? openRawImageSource(files[i], rawFormat)
+                                              : openImageSource(files[i]);
+            double read = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+            if(!source){
+                cv::AutoLock guard(lock);
+                totals.read += read;
+                totals.failed++;
+                std::printf("%d,%s,unreadable,,,,,,,,,,\n", i, csvQuote(files[i]).c_str());
+                if(sink){
+                    MeasureRecord record;
+                    record.index = i;
+                    record.image = files[i];
+                    record.ok = false;
+                    sink->write(record);
+                }
+                continue;
+            }
+
+            MeasureResult result = core.measure(source, params);
+
+            start = cv::getTickCount();
+            std::vector< std::vector<cv::Point3f> > lines(result.lines.size());
+            for(unsigned int n = 0 ; n < lines.size() ; n++)
+                lines[n] = result.lines[n].edges;
+
+            cv::Point p1,p2;
+            cv::Point2f center;
+            float radius = 0;
+            bool fitted = (params.offsets == MeasureParams::Rays)
+                    ? fitEdgeCircle(lines, slopeType, center, radius)
+                    : fitEdgeLine(lines, slopeType, p1, p2);
+            double fit = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+            cv::AutoLock guard(lock);
+            totals.read += read;
+            totals.fit += fit;
+            totals.measure.smooth += result.timing.smooth;
+            totals.measure.sample += result.timing.sample;
+            totals.measure.edges += result.timing.edges;
+            totals.images++;
+            std::printf("%d,%s,ok,%d,%d,%d,%d,%d,%d,%d,%.2f,%.2f,%.2f\n", i, csvQuote(files[i]).c_str(),
+                        (int)result.edges.size(), (int)result.lines.size(), fitted ? 1 : 0,
+                        p1.x, p1.y, p2.x, p2.y, center.x, center.y, radius);
+            std::fflush(stdout);
+
+            if(sink){
+                start = cv::getTickCount();
+                MeasureRecord record;
+                record.index = i;
+                record.image = files[i];
+                record.lines.swap(lines);
+                record.lineFitted = fitted && params.offsets != MeasureParams::Rays;
+                record.p1 = p1;
+                record.p2 = p2;
+                record.circleFitted = fitted && params.offsets == MeasureParams::Rays;
+                record.center = center;
+                record.radius = radius;
+                sink->write(record);
+                totals.write += (cv::getTickCount() - start) / cv::getTickFrequency();
+            }
+        }
+    });
+    if(sink && !sink->flush())
+        std::fprintf(stderr, "cannot write to %s\n", parser.get<std::string>("out").c_str());
+
+    wall.stop();
+    double seconds = wall.getTimeSec();
+    std::fprintf(stderr, "%d images (%d unreadable) in %.3f s on %d threads: %.1f images/s\n",
+                 totals.images + totals.failed, totals.failed, seconds, cv::getNumThreads(),
+                 seconds > 0 ? (totals.images + totals.failed) / seconds : 0.0);
+    std::fprintf(stderr, "time per stage, summed over threads, ms per image:\n");
+    int n = std::max(totals.images, 1);
+    std::fprintf(stderr, "  read    %8.3f\n", totals.read*1000 / (totals.images + totals.failed));
+    std::fprintf(stderr, "  smooth  %8.3f\n", totals.measure.smooth*1000 / n);
+    std::fprintf(stderr, "  sample  %8.3f\n", totals.measure.sample*1000 / n);
+    std::fprintf(stderr, "  edges   %8.3f\n", totals.measure.edges*1000 / n);
+    std::fprintf(stderr, "  fit     %8.3f\n", totals.fit*1000 / n);
+    if(sink)
+        std::fprintf(stderr, "  write   %8.3f\n", totals.write*1000 / n);
+
+    return totals.failed ? 2 : 0;
+}
@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Command line batch measurement, see measurecli.cpp.
+# Links only the measurement core and OpenCV, runs without a display.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = measurecli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += \
+    measurecli.cpp
+
+include(measurecore.pri)
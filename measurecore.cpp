@@ -0,0 +1,797 @@
+#include "measurecore.h"
+#include "spline.h"
+#include "profilesmooth.h"
+#include "linesampler.h"
+#include "polarsampler.h"
+#include "measurelog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+MeasureParams::MeasureParams() :
+    stage(ImageOnly),
+    kernel(1),
+    backend(BlurCache::Gaussian),
+    roiSmooth(false),
+    profileStage(false),
+    width(1),
+    stripMedian(false),
+    amplitude(0),
+    bitDepth(0),
+    analytic(false),
+    sampling(PixelSteps),
+    step(1.0),
+    offsets(NoOffsets),
+    offsetNum(0),
+    offsetVal(0),
+    rayDegree(0)
+{
+}
+
+MeasureTiming::MeasureTiming() :
+    smooth(0),
+    sample(0),
+    edges(0)
+{
+}
+
+MeasureResult::MeasureResult() :
+    cancelled(true),
+    hasAccuracy(false)
+{
+}
+
+namespace
+{
+
+// parameters that change the sampled AB profile (roiSmooth does not, the
+// region blur is pixel exact)
+bool sameProfile(const MeasureParams &p, const MeasureParams &q)
+{
+    return p.a == q.a && p.b == q.b && p.kernel == q.kernel && p.backend == q.backend
+            && p.profileStage == q.profileStage && p.width == q.width && p.stripMedian == q.stripMedian
+            && p.sampling == q.sampling && (p.sampling == MeasureParams::PixelSteps || p.step == q.step);
+}
+
+// the pixels the offset lines and rays read: the image or its smoothing
+bool sameSmoothing(const MeasureParams &p, const MeasureParams &q)
+{
+    return p.kernel == q.kernel && p.backend == q.backend && p.profileStage == q.profileStage;
+}
+
+bool sameOffsets(const MeasureParams &p, const MeasureParams &q)
+{
+    return p.offsets == q.offsets && p.offsetNum == q.offsetNum
+            && p.offsetVal == q.offsetVal && p.rayDegree == q.rayDegree;
+}
+
+bool stopped(const CancelCheck &cancelled)
+{
+    return cancelled && cancelled();
+}
+
+double seconds(int64 since)
+{
+    return (cv::getTickCount() - since) / cv::getTickFrequency();
+}
+
+// nearest pixel, where the pixel steps of cv::LineIterator start and end
+cv::Point pixel(cv::Point2f p)
+{
+    return cv::Point(cvRound(p.x), cvRound(p.y));
+}
+
+// parallelLines of the measurement: from the rounded A and B in pixel
+// steps, the lines LineIterator draws, from the exact ones otherwise
+void offsetLines(const MeasureParams &params, std::vector<cv::Point> &starts, std::vector<cv::Point> &ends,
+                 std::vector<bool> &origin, cv::Rect &bounds)
+{
+    cv::Point2f a = params.a, b = params.b;
+    if(params.sampling == MeasureParams::PixelSteps){
+        a = pixel(params.a);
+        b = pixel(params.b);
+    }
+    parallelLines(a, b, params.offsetNum, params.offsetVal, starts, ends, origin, bounds);
+}
+
+// image position of the sub-sample index x, between the two samples around it
+cv::Point2f alongLine(const std::vector<cv::Point2f> &points, double x)
+{
+    int i = std::min(std::max(cvFloor(x), 0), (int)points.size()-1);
+    if(i+1 >= (int)points.size())
+        return points[i];
+    float t = (float)(x - i);
+    return points[i] + t*(points[i+1] - points[i]);
+}
+
+// the pixels of AB span the rectangle of its end points
+cv::Rect lineBounds(const MeasureParams &params)
+{
+    int x0 = cvFloor(std::min(params.a.x, params.b.x)), y0 = cvFloor(std::min(params.a.y, params.b.y));
+    int x1 = cvCeil(std::max(params.a.x, params.b.x)), y1 = cvCeil(std::max(params.a.y, params.b.y));
+    return cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+cv::Rect grown(const cv::Rect &r, int margin)
+{
+    return cv::Rect(r.x-margin, r.y-margin, r.width+2*margin, r.height+2*margin);
+}
+
+// samples read past the lines by half the strip width, plus 2 pixels of
+// interpolation support (bicubic)
+cv::Rect samplingBounds(const MeasureParams &params, const cv::Rect &bounds)
+{
+    int pad = (params.width > 1) ? params.width/2 + 1 : 0;
+    if(params.sampling != MeasureParams::PixelSteps)
+        pad += 2;
+    return cv::Rect(bounds.x-pad, bounds.y-pad, bounds.width+2*pad, bounds.height+2*pad);
+}
+
+} // namespace
+
+MeasureCore::MeasureCore() :
+    m_backend(BlurCache::Gaussian),
+    m_profileValid(false),
+    m_linesValid(false),
+    m_accuracyValid(false),
+    m_accuracyGreyLevel(1)
+{
+}
+
+MeasureResult MeasureCore::measure(const cv::Mat &image, const MeasureParams &params, const CancelCheck &cancelled)
+{
+    MeasureResult result;
+    result.params = params;
+    if(stopped(cancelled))
+        return result;
+
+    if(image.data != m_image.data || image.size() != m_image.size()){
+        m_image = image;
+        m_blurCache.setImage(image);
+        m_profileValid = m_linesValid = m_accuracyValid = false;
+        m_polar.releaseSource();   //the old buffer may be freed and reused by a later image
+    }
+    m_blurCache.setBackend((BlurCache::Backend)params.backend);
+
+    //accuracy of the recursive engine against GaussianBlur, for sign-off:
+    //once per image and kernel, over the area the measurement reads (the
+    //whole image only while there is no line yet)
+    if(params.backend != m_backend && params.backend == BlurCache::Recursive && !m_image.empty()){
+        double greyLevel = amplitudeScale(m_image.depth(), params.bitDepth);
+        if(!m_accuracyValid || m_accuracy.kernel != params.kernel || m_accuracyGreyLevel != greyLevel){
+            cv::Rect image(0, 0, m_image.cols, m_image.rows);
+            cv::Rect region = measureBounds(params) & image;
+            if(region.area() == 0)
+                region = image;
+            m_accuracy = compareWithGaussianBlur(m_image, params.kernel, greyLevel, region);
+            m_accuracyGreyLevel = greyLevel;
+            m_accuracyValid = true;
+        }
+        result.accuracy = m_accuracy;
+        result.hasAccuracy = true;
+    }
+
+    if(params.stage != MeasureParams::ImageOnly){
+        if(!sampleMain(params, cancelled, result.timing))
+            return result;
+        result.profile = m_profile.values();
+    }
+
+    if(params.stage == MeasureParams::Edges){
+        int64 start = cv::getTickCount();
+        double threshold = params.amplitude * amplitudeScale(m_image.depth(), params.bitDepth);
+        findPeak(m_profile, result.peakX, result.peakY, threshold);
+
+        std::vector<cv::Point3d> ffPoints = ffSlope(m_profile, threshold, params.analytic); //ffSlope.x is sub-sample *INDEX* for linePoints(from user)  ,ffSlope.y is PixColor
+        result.edges.resize(ffPoints.size());
+        for(unsigned int i = 0 ; i < ffPoints.size() ; i++)
+            result.edges[i] = alongLine(m_points, ffPoints[i].x);
+
+        result.timing.edges += seconds(start);
+
+        if(params.offsets != MeasureParams::NoOffsets){
+            if(!sampleOffsets(params, cancelled, result.timing))
+                return result;
+            start = cv::getTickCount();
+            measureOffsets(params, cancelled, result);
+            result.timing.edges += seconds(start);
+        }
+    }
+
+    if(stopped(cancelled))
+        return result;
+    m_backend = params.backend;
+    result.cancelled = false;
+    return result;
+}
+
+MeasureResult MeasureCore::measure(const cv::Ptr<ImageSource> &source, const MeasureParams &params, const CancelCheck &cancelled)
+{
+    cv::Mat decoded = source ? source->decoded() : cv::Mat();
+    if(!source || !decoded.empty())
+        return measure(decoded, params, cancelled);
+
+    cv::Rect image(cv::Point(), source->size());
+    cv::Rect needed = measureBounds(params) & image;
+    if(params.stage == MeasureParams::ImageOnly && source == m_source)
+        needed = m_region;  //nothing to read, the accuracy check runs on the region there is
+    else if(needed.area() == 0){    //lines off the image: the pixel nearest to A
+        cv::Point p(std::min(std::max(cvFloor(params.a.x), 0), image.width-1),
+                    std::min(std::max(cvFloor(params.a.y), 0), image.height-1));
+        needed = cv::Rect(p, cv::Size(1,1));
+    }
+
+    if(source != m_source || (needed & m_region) != needed){
+        //room for the line to move a little, or the kernel to grow, without
+        //a new region; a new region starts the caches afresh
+        cv::Rect region = grown(needed, 64 + std::max(needed.width, needed.height)/4) & image;
+        m_regionPixels = source->read(region);
+        m_region = region;
+        m_source = source;
+    }
+
+    //the region is measured as an image of its own, its coordinates shifted
+    MeasureParams local = params;
+    cv::Point2f shift((float)m_region.x, (float)m_region.y);
+    local.a -= shift;
+    local.b -= shift;
+    MeasureResult result = measure(m_regionPixels, local, cancelled);
+    result.params = params;
+    for(unsigned int i = 0; i < result.edges.size(); i++)
+        result.edges[i] += shift;
+    for(unsigned int n = 0; n < result.lines.size(); n++){
+        OffsetLineResult &line = result.lines[n];
+        line.start += m_region.tl();
+        line.end += m_region.tl();
+        for(unsigned int i = 0; i < line.edges.size(); i++){
+            line.edges[i].x += shift.x;
+            line.edges[i].y += shift.y;
+        }
+    }
+    return result;
+}
+
+cv::Mat MeasureCore::smoothed(const MeasureParams &params, const cv::Rect &bounds)
+{
+    if(params.kernel <= 1 || params.profileStage)  //raw samples, or the 1-D stage smooths each profile instead
+        return m_image;
+
+    //only the largest kernel of the old 1..MAX_KERNEL_LENGTH loop was ever kept
+    if(params.roiSmooth)
+        return m_blurCache.get(params.kernel, bounds);
+    return m_blurCache.get(params.kernel);
+}
+
+void MeasureCore::lineProfile(const MeasureParams &params, const cv::Mat &blurred, cv::Point2f a, cv::Point2f b,
+                              std::vector<cv::Point2f> &points, std::vector<double> &axisY) const
+{
+    //the 1-D stage samples the raw image and smooths the profile along the
+    //line afterwards, the 2-D stage reads the smoothed image
+    bool profileStage = params.kernel > 1 && params.profileStage;
+    const cv::Mat &source = profileStage ? m_image : blurred;
+    std::vector<double> raw;
+    std::vector<double> &samples = profileStage ? raw : axisY;
+
+    if(params.sampling == MeasureParams::PixelSteps){
+        cv::LineIterator it(m_image, pixel(a), pixel(b), 8 ,false);//'true' is left to right ,not order || 'false' A point to B point
+        points.resize(it.count);
+        for(int i = 0; i < it.count; i++, ++it)
+            points[i] = it.pos();
+        sampleProfile(source, points, lineNormal(pixel(a),pixel(b)), params.width, params.stripMedian, samples);
+    }
+    else{
+        int interpolation = (params.sampling == MeasureParams::Bicubic) ? cv::INTER_CUBIC : cv::INTER_LINEAR;
+        cv::Point2f delta = lineDelta(a, b, params.step);
+        int count = lineSampleCount(a, b, params.step);
+        linePositions(a, delta, count, points);
+
+        samples.resize(count);
+        cv::Point2d normal = lineNormal(a,b);
+        sampleStrip(source, a, delta, cv::Point2f((float)normal.x, (float)normal.y), count,
+                    params.width, interpolation, params.stripMedian, samples.data());
+    }
+
+    if(profileStage)
+        gaussianSmooth1D(raw,axisY,params.kernel);
+}
+
+bool MeasureCore::sampleMain(const MeasureParams &params, const CancelCheck &cancelled, MeasureTiming &timing)
+{
+    if(m_profileValid && sameProfile(params, m_profileFor))
+        return true;
+    m_profileValid = m_linesValid = false;
+
+    int64 start = cv::getTickCount();
+    cv::Mat blurred = smoothed(params, samplingBounds(params, lineBounds(params)));
+    timing.smooth += seconds(start);
+    if(stopped(cancelled))
+        return false;
+
+    start = cv::getTickCount();
+    std::vector<double> axisY;
+    lineProfile(params, blurred, params.a, params.b, m_points, axisY);
+    m_profile.setProfile(axisY);   //persistence runs once here, amplitude changes reuse it
+    timing.sample += seconds(start);
+    m_profileFor = params;
+    m_profileValid = true;
+    return true;
+}
+
+bool MeasureCore::sampleOffsets(const MeasureParams &params, const CancelCheck &cancelled, MeasureTiming &timing)
+{
+    if(m_linesValid && sameOffsets(params, m_linesFor))
+        return true;
+    m_linesValid = false;
+
+    std::vector<cv::Point> starts,ends;
+    std::vector<bool> origin;
+    cv::Rect bounds;
+    if(params.offsets == MeasureParams::ParallelLines){
+        offsetLines(params, starts, ends, origin, bounds);
+    }
+    else{
+        rayLines(pixel(params.a), pixel(params.b), params.offsetNum, params.rayDegree, ends, origin, bounds);
+        starts.assign(ends.size(), pixel(params.a));
+    }
+
+    m_lines.resize(ends.size());  //existing entries keep their buffers
+    for(unsigned int n = 0 ; n < m_lines.size() ; n++){
+        m_lines[n].start = starts[n];
+        m_lines[n].end = ends[n];
+        m_lines[n].origin = origin[n];
+    }
+
+    //smoothed once, shared by every offset line or ray
+    int64 start = cv::getTickCount();
+    cv::Mat blurred = smoothed(params, samplingBounds(params, bounds));
+    timing.smooth += seconds(start);
+    if(stopped(cancelled))
+        return false;
+
+    start = cv::getTickCount();
+
+    if(params.offsets == MeasureParams::ParallelLines)
+        sampleParallel(params, blurred, cancelled);
+    else
+        samplePolar(params, blurred, cancelled);
+    timing.sample += seconds(start);
+    if(stopped(cancelled))
+        return false;   //some lines were skipped, m_linesValid stays false
+
+    m_linesFor = params;
+    m_linesValid = true;
+    return true;
+}
+
+void MeasureCore::sampleParallel(const MeasureParams &params, const cv::Mat &blurred, const CancelCheck &cancelled)
+{
+    //every parallel line is AB moved along its normal, so one step sequence
+    //serves all of them: the lines (and the rows of their strips) are read
+    //in one batch into a lines x samples matrix
+    bool profileStage = params.kernel > 1 && params.profileStage;
+    const cv::Mat &source = profileStage ? m_image : blurred;
+    int width = std::max(params.width, 1);
+    bool pixelSteps = (params.sampling == MeasureParams::PixelSteps);
+    cv::Point2d normal = pixelSteps ? lineNormal(pixel(params.a), pixel(params.b)) : lineNormal(params.a, params.b);
+    int lines = (int)m_lines.size();
+
+    if(pixelSteps){
+        cv::Point a = pixel(params.a), b = pixel(params.b);
+        cv::LineIterator it(m_image, a, b, 8 ,false);
+        std::vector<cv::Point> pattern(it.count);
+        for(int i = 0; i < it.count; i++, ++it)
+            pattern[i] = it.pos() - a;
+        m_pattern.assign(pattern.begin(), pattern.end());
+
+        //every line is clipped to the image on its own, as lineProfile does.
+        //Those that come out as AB's pixels moved by a whole-pixel shift, all
+        //of them unless the border cuts some, are read in one batch with the
+        //strip offsets sampleProfile uses; the others are sampled alone
+        std::vector<cv::Point> shifts;
+        shifts.reserve(lines*width);
+        int rows = 0;
+        for(int n = 0; n < lines; n++){
+            OffsetLine &line = m_lines[n];
+            bool batched = (line.end - line.start == b - a);
+            if(batched){
+                cv::LineIterator own(m_image, line.start, line.end, 8 ,false);
+                batched = (own.count == it.count);
+                for(int i = 0; batched && i < own.count; i++, ++own)
+                    batched = (own.pos() == line.start + pattern[i]);
+            }
+            line.offset = line.start;
+            line.delta = cv::Point2f();
+            line.row = batched ? rows++ : -1;
+            for(int k = 0; batched && k < width; k++){
+                double t = k - (width-1) * 0.5;
+                shifts.push_back((line.start - a) + cv::Point(cvRound(t*normal.x), cvRound(t*normal.y)));
+            }
+        }
+        samplePixelLines(source, pattern, shifts, m_stripRows);
+    }
+    else{
+        int interpolation = (params.sampling == MeasureParams::Bicubic) ? cv::INTER_CUBIC : cv::INTER_LINEAR;
+        cv::Point2f delta = lineDelta(params.a, params.b, params.step);
+        int count = lineSampleCount(params.a, params.b, params.step);
+        linePositions(cv::Point2f(0, 0), delta, count, m_pattern);
+
+        //exact shifts, line n lies (offsetNum - n) * offsetVal pixels along the normal
+        std::vector<cv::Point2f> shifts(lines*width);
+        for(int n = 0; n < lines; n++){
+            double d = (double)(params.offsetNum - n) * params.offsetVal;
+            m_lines[n].offset = cv::Point2f((float)(params.a.x + d*normal.x), (float)(params.a.y + d*normal.y));
+            m_lines[n].delta = cv::Point2f();
+            m_lines[n].row = n;
+            for(int k = 0; k < width; k++){
+                double t = d + k - (width-1) * 0.5;
+                shifts[n*width + k] = cv::Point2f((float)(t*normal.x), (float)(t*normal.y));
+            }
+        }
+        sampleLines(source, params.a, delta, count, shifts, interpolation, m_stripRows);
+    }
+    if(stopped(cancelled))
+        return;
+    reduceStrips(m_stripRows, width, params.stripMedian, m_lineProfiles);
+
+    profilesFromRows(params, blurred, cancelled);
+}
+
+void MeasureCore::samplePolar(const MeasureParams &params, const cv::Mat &blurred, const CancelCheck &cancelled)
+{
+    //the rays share A, so the disc around it is resampled once into an
+    //(angle x radius) image whose rows are the rays, in exact angle steps
+    //whatever the resolution
+    bool profileStage = params.kernel > 1 && params.profileStage;
+    const cv::Mat &source = profileStage ? m_image : blurred;
+    cv::Point2f a = params.a, b = params.b;
+    if(params.sampling == MeasureParams::PixelSteps){  //the rays drawn from the rounded A
+        a = pixel(params.a);
+        b = pixel(params.b);
+    }
+
+    PolarGeometry geometry;
+    geometry.center = a;
+    geometry.radius = (float)std::sqrt((double)(b.x-a.x)*(b.x-a.x) + (double)(b.y-a.y)*(b.y-a.y));
+    geometry.angle = std::atan2((double)(b.y-a.y), (double)(b.x-a.x));
+    geometry.angleStep = params.rayDegree * CV_PI / 180;
+    geometry.rays = (int)m_lines.size();
+    geometry.width = std::max(params.width, 1);
+
+    //pixel steps read whole pixels one pixel apart along each ray
+    int interpolation = cv::INTER_NEAREST;
+    geometry.step = 1.0;
+    if(params.sampling != MeasureParams::PixelSteps){
+        interpolation = (params.sampling == MeasureParams::Bicubic) ? cv::INTER_CUBIC : cv::INTER_LINEAR;
+        geometry.step = params.step;
+    }
+
+    for(int n = 0; n < geometry.rays; n++){
+        cv::Point2f d = geometry.direction(n);
+        m_lines[n].offset = a;
+        m_lines[n].delta = cv::Point2f((float)(d.x*geometry.step), (float)(d.y*geometry.step));
+        m_lines[n].row = n;
+    }
+    //the float copy of the source is reused while the smoothing stays
+    if(!sameSmoothing(params, m_polarFor))
+        m_polar.releaseSource();
+    m_polarFor = params;
+    m_polar.sample(source, geometry, interpolation, params.stripMedian, m_lineProfiles);
+    if(stopped(cancelled))
+        return;
+
+    profilesFromRows(params, blurred, cancelled);
+}
+
+void MeasureCore::profilesFromRows(const MeasureParams &params, const cv::Mat &blurred, const CancelCheck &cancelled)
+{
+    bool profileStage = params.kernel > 1 && params.profileStage;
+    int lines = (int)m_lines.size();
+
+    //persistence straight from the rows of the matrix
+    cv::parallel_for_(cv::Range(0, lines), [&](const cv::Range &range){
+        std::vector<double> raw,axisY;
+        for(int n = range.start ; n < range.end ; n++){
+            if(stopped(cancelled))
+                return;
+            OffsetLine &line = m_lines.at(n);
+            if(line.row < 0){   //cut by the image border, sampled along its own pixels
+                lineProfile(params,blurred,line.start,line.end,line.points,axisY);
+                line.profile.setProfile(axisY);
+                continue;
+            }
+            line.points.clear();
+            const double *row = m_lineProfiles.ptr<double>(line.row);
+            if(profileStage){
+                raw.assign(row, row + m_lineProfiles.cols);
+                gaussianSmooth1D(raw,axisY,params.kernel);
+                line.profile.setProfile(axisY);
+            }
+            else{
+                line.profile.setProfile(row, m_lineProfiles.cols);
+            }
+        }
+    });
+}
+
+void MeasureCore::measureOffsets(const MeasureParams &params, const CancelCheck &cancelled, MeasureResult &result) const
+{
+    //edge search of every line on all cores, each writes only its own slot so
+    //the lines stay in order
+    result.lines.resize(m_lines.size());
+    double threshold = params.amplitude * amplitudeScale(m_image.depth(), params.bitDepth);
+
+    cv::parallel_for_(cv::Range(0,(int)m_lines.size()), [&](const cv::Range &range){
+        for(int n = range.start ; n < range.end ; n++){
+            if(stopped(cancelled))
+                return;
+            const OffsetLine &line = m_lines.at(n);
+            OffsetLineResult &out = result.lines.at(n);
+            out.start = line.start;
+            out.end = line.end;
+            out.origin = line.origin;
+
+            std::vector<cv::Point3d> ffPoints = ffSlope(line.profile,threshold,params.analytic);
+            out.edges.resize(ffPoints.size());
+            for(unsigned int i=0 ;i<ffPoints.size() ;i++){
+                cv::Point2f p = edgePosition(line, ffPoints.at(i).x);
+                out.edges.at(i) = cv::Point3f(p.x, p.y, (float)ffPoints.at(i).z);
+            }
+        }
+    });
+}
+
+cv::Point2f MeasureCore::edgePosition(const OffsetLine &line, double x) const
+{
+    if(!line.points.empty())
+        return alongLine(line.points, x);
+    if(line.delta != cv::Point2f())     //polar ray, evenly spaced from its start
+        return line.offset + (float)x*line.delta;
+    return alongLine(m_pattern, x) + line.offset;
+}
+
+double amplitudeScale(int depth, int bitDepth)
+{
+    if(depth == CV_32F)
+        return 1.0 / 255;
+    if(depth == CV_16U){
+        int bits = (bitDepth > 8 && bitDepth < 16) ? bitDepth : 16;
+        return ((1 << bits) - 1) / 255.0;
+    }
+    return 1.0;
+}
+
+void findPeak(const ProfileAnalysis &profile,std::vector<double> &outputX,std::vector<double> &outputY,double distanceAmpi){
+    profile.peaks(distanceAmpi,outputX,outputY);   //persistence was computed by setProfile
+}
+
+std::vector<double> linspace(double a, double b, int n) {
+    std::vector<double> array;
+    double step = (b-a) / (n-1);
+
+    while(a <= b) {
+        array.push_back(a);
+        a += step;           // could recode to better handle rounding errors
+    }
+    return array;
+}
+
+std::vector<cv::Point3d> ffSlope(const ProfileAnalysis &profile,double lengthAmpi,bool analytic){
+
+    const std::vector<double> &smoothY = profile.values();
+    std::vector<double> peakX , peakY;
+    findPeak(profile,peakX,peakY,lengthAmpi);
+    for(unsigned int i = 0; i < peakX.size(); i++)
+        MEASURE_TRACE("peak[%u] x=%.0f y=%.2f", i, peakX[i], peakY[i]);
+    if(peakX.size()<2)
+        return std::vector<cv::Point3d>();
+
+    std::vector<cv::Point3d> ffPoints(peakX.size()-1);
+
+    //knots are the sample indexes, each segment reads its slice of them and
+    //of smoothY in place; one spline keeps its solver buffers for all segments
+    std::vector<double> knots(smoothY.size());
+    for(unsigned int i =0 ;i<knots.size();i++)
+        knots[i] = i;
+    tk::spline s;
+
+    for(int t=0 ; t<peakX.size()-1 ; t++){
+        int first = peakX[t];
+        int count = peakX[t+1]-peakX[t]+1;
+        s.set_points(&knots[first],&smoothY[first],count);
+
+        if(analytic){   //steepest point read from the cubic coefficients, no resampling
+            int sign = (peakY[t+1] > peakY[t]) ? 1 : (peakY[t+1] < peakY[t]) ? -1 : 0;
+            if(sign != 0){
+                double x;
+                if(sign*s.steepest_slope(sign,x) > 0){
+                    ffPoints.at(t).x = x;
+                    ffPoints.at(t).y = s(x);
+                }
+                ffPoints.at(t).z = (sign > 0) ? 1 : 2; //increase slope : decrease slope
+            }
+            continue;
+        }
+
+        std::vector<double> splitX = linspace(knots[first],knots[first+count-1],count*10);
+
+        std::vector<double> axisX, axisY;
+        for(int i =0 ;i<splitX.size();i++){
+            axisX.push_back(splitX[i]);
+            axisY.push_back(s(splitX[i]));
+            MEASURE_TRACE("spline[%d] %.2f %.3f", i, axisX[i], axisY[i]);
+        }
+
+        double slope = 0.0;
+        double ffPoint = 0.0;
+        if(peakY[t+1] > peakY[t]){
+            for(int i =0 ; i < axisX.size()-1 ; i++){
+                slope = (axisY[i+1]-axisY[i]) / (axisX[i+1]-axisX[i]);
+                MEASURE_TRACE("slope %.4f", slope);
+                if( slope > ffPoint ){
+                    ffPoint=slope;
+                    ffPoints.at(t).x = axisX[i];
+                    ffPoints.at(t).y = axisY[i];
+                }
+            }
+            ffPoints.at(t).z = 1; //increase slope
+        }
+        else if(peakY[t+1] < peakY[t]){
+            for(int i =0 ; i < axisX.size()-1 ; i++){
+                slope = (axisY[i+1]-axisY[i]) / (axisX[i+1]-axisX[i]);
+                MEASURE_TRACE("slope %.4f", slope);
+                if( slope < ffPoint ){
+                    ffPoint=slope;
+                    ffPoints.at(t).x = axisX[i];
+                    ffPoints.at(t).y = axisY[i];
+                }
+            }
+            ffPoints.at(t).z = 2; //decrease slope
+        }
+
+    }
+
+
+    return ffPoints;
+}
+
+void parallelLines(cv::Point2f a, cv::Point2f b, int num, int val,
+                   std::vector<cv::Point> &starts, std::vector<cv::Point> &ends,
+                   std::vector<bool> &origin, cv::Rect &bounds)
+{
+    //line n is AB moved d = (num - n) * val along the normal, the shift the
+    //samplers use, rounded to the nearest pixel
+    cv::Point2d normal = lineNormal(a, b);
+    starts.resize(num*2+1);
+    ends.resize(num*2+1);
+    origin.resize(num*2+1);
+    for(int n = 0 ; n<num*2+1 ; n++){// Create N line
+        double d = (double)(num - n) * val;
+        starts[n] = cv::Point(cvRound(a.x + d*normal.x), cvRound(a.y + d*normal.y));
+        ends[n] = cv::Point(cvRound(b.x + d*normal.x), cvRound(b.y + d*normal.y));
+        origin[n] = (n == num);    //protect Origin Line
+    }
+
+    //the outermost offset lines on both sides bound all the others
+    cv::Point corners[4] = { starts.front(), ends.front(), starts.back(), ends.back() };
+    bounds = cv::boundingRect(std::vector<cv::Point>(corners, corners + 4));
+}
+
+void rayLines(cv::Point a, cv::Point b, int num, double degree,
+              std::vector<cv::Point> &ends, std::vector<bool> &origin, cv::Rect &bounds)
+{
+    cv::Point A = a, B = b;
+    double radius = std::sqrt((double)(B.x-A.x)*(B.x-A.x) + (double)(B.y-A.y)*(B.y-A.y));
+
+    //angles from AB, clockwise on screen (image y points down); the same
+    //directions samplePolar resamples
+    double angleFromAB = atan2((double)(B.y-A.y), (double)(B.x-A.x));
+    double slice = degree*CV_PI/180;
+    int r = (int)std::ceil(radius);
+    bounds = cv::Rect(A.x-r-1, A.y-r-1, 2*r+3, 2*r+3);
+
+    ends.resize(num+1);
+    origin.resize(num+1);
+    for(int n =0;n<num+1;n++){ //n=0 is Origin line
+        double re_angleFromAB = angleFromAB + slice*n;
+        if(n!=0){
+            ends[n].x = cvRound(cos(re_angleFromAB) * radius + A.x);
+            ends[n].y = cvRound(sin(re_angleFromAB) * radius + A.y);
+        }
+        else{
+            ends[n] = B;
+        }
+        origin[n] = (n==0);
+    }
+}
+
+cv::Rect measureBounds(const MeasureParams &params)
+{
+    if(params.stage == MeasureParams::ImageOnly)
+        return cv::Rect();
+
+    cv::Rect bounds = samplingBounds(params, lineBounds(params));
+    if(params.stage == MeasureParams::Edges && params.offsets == MeasureParams::ParallelLines){
+        std::vector<cv::Point> starts,ends;
+        std::vector<bool> origin;
+        cv::Rect lines;
+        offsetLines(params, starts, ends, origin, lines);
+        bounds |= samplingBounds(params, lines);
+    }
+    else if(params.stage == MeasureParams::Edges && params.offsets == MeasureParams::Rays){
+        //the disc PolarGeometry::bounds resamples, one pixel more for the
+        //rounded A and B of pixel steps
+        double radius = cv::norm(params.b - params.a);
+        int pad = (int)std::ceil(radius) + std::max(params.width, 1)/2 + 4;
+        bounds |= cv::Rect(cvFloor(params.a.x) - pad, cvFloor(params.a.y) - pad, 2*pad + 2, 2*pad + 2);
+    }
+
+    //each smoothed pixel reads the kernel's reach around it; the 1-D stage
+    //smooths along the profiles instead
+    if(params.kernel > 1 && !params.profileStage){
+        int margin = params.kernel/2;
+        if(params.backend == BlurCache::Recursive)
+            margin = recursiveGaussianMargin(kernelSigma(params.kernel));
+        bounds = grown(bounds, margin);
+    }
+    return bounds;
+}
+
+namespace
+{
+
+// last edge of every line whose last edge has "slopeType"
+std::vector<cv::Point2f> lastEdges(const std::vector< std::vector<cv::Point3f> > &lines, int slopeType)
+{
+    std::vector<cv::Point2f> interest_line;
+    for(unsigned int i=0 ; i<lines.size() ; i++){
+        if(lines.at(i).size() && (int)lines.at(i).back().z == slopeType) //each offset line select only last point
+            interest_line.push_back(cv::Point2f(lines.at(i).back().x,lines.at(i).back().y));
+    }
+    return interest_line;
+}
+
+} // namespace
+
+bool fitEdgeLine(const std::vector< std::vector<cv::Point3f> > &lines, int slopeType,
+                 cv::Point &p1, cv::Point &p2)
+{
+    if(lines.size() < 3)
+        return false;
+
+    std::vector<cv::Point2f> interest_line = lastEdges(lines, slopeType); //Just one line interested
+    if(interest_line.size() <= 1)   //more than 1 point to create line
+        return false;
+
+    cv::Vec4i re_interest_line;             //Point(x,y) use vec4:(vx, vy, x0, y0) , Point(x,y,z) use vec6:(vx, vy, vz, x0, y0, z0)
+    cv::fitLine(interest_line,re_interest_line,cv::DIST_L2, 0, 0.01, 0.01);
+
+    p1 = p2 = cv::Point();
+    if(re_interest_line[0]){    //re_interest_line[0] == 1 ; it is vertical line
+        int changeX = (int)(interest_line.at(0).x-interest_line.at(interest_line.size()-1).x)/2;
+        p1 = cv::Point(re_interest_line[2]+changeX, re_interest_line[3]);
+        p2 = cv::Point(re_interest_line[2]-changeX, re_interest_line[3]);
+    }
+    else if(re_interest_line[1]){    //re_interest_line[1] == 1 ; it is horizental line
+        int changeY = (int)(interest_line.at(0).y-interest_line.at(interest_line.size()-1).y)/2;
+        p1 = cv::Point(re_interest_line[2], re_interest_line[3]+changeY);
+        p2 = cv::Point(re_interest_line[2], re_interest_line[3]-changeY);
+    }
+    return true;
+}
+
+bool fitEdgeCircle(const std::vector< std::vector<cv::Point3f> > &lines, int slopeType,
+                   cv::Point2f &center, float &radius)
+{
+    if(lines.size() < 3)
+        return false;
+
+    std::vector<cv::Point2f> point = lastEdges(lines, slopeType);
+    if(point.size() <= 1)
+        return false;
+
+    cv::minEnclosingCircle(point,center,radius);
+    return true;
+}
@@ -0,0 +1,209 @@
+#ifndef MEASURECORE_H
+#define MEASURECORE_H
+
+#include "blurcache.h"
+#include "imagesource.h"
+#include "polarsampler.h"
+#include "profileanalysis.h"
+#include "recursivegaussian.h"
+
+#include <functional>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// Measurement core: everything between a grey image plus a line and the
+// edge points, with no Qt and no global state. Parameters come in as
+// MeasureParams, results go out as MeasureResult. One MeasureCore per
+// measurement, so several can run at once in one process.
+
+// Everything a measurement depends on.
+struct MeasureParams
+{
+    MeasureParams();
+
+    enum Stage {
+        ImageOnly,      // no line yet, only image level work (blur accuracy)
+        Profile,        // sample and smooth the AB line
+        Edges           // plus peaks, edges and the offset lines or rays
+    };
+    enum Offsets {
+        NoOffsets,
+        ParallelLines,
+        Rays
+    };
+    enum Sampling {
+        PixelSteps,     // the 8-connected pixels from A to B, as cv::LineIterator walks them
+        Bilinear,       // every "step" pixels along the line, see linesampler.h
+        Bicubic
+    };
+
+    Stage stage;
+    cv::Point2f a,b;        // AB line, image coordinates (integers are pixel centres); PixelSteps rounds them
+    int kernel;             // Gaussian kernel size, <= 1 samples the raw image
+    int backend;            // BlurCache::Backend
+    bool roiSmooth;         // blur only the area the lines cover
+    bool profileStage;      // smooth each sampled profile (1-D) instead of the image
+    int width;              // strip across the line each sample integrates, 1 = the line alone
+    bool stripMedian;       // median across the strip instead of the mean
+    int amplitude;          // persistence threshold of findPeak, in 8-bit grey levels, see amplitudeScale()
+    int bitDepth;           // significant bits of a 16-bit image (12 for a 12-bit sensor), 0 = all 16
+    bool analytic;          // steepest slope from the spline coefficients
+    Sampling sampling;
+    double step;            // pixels between samples, Bilinear and Bicubic only
+
+    Offsets offsets;
+    int offsetNum;          // lines on each side of AB, or rays after AB
+    int offsetVal;          // pixels between parallel lines
+    double rayDegree;       // degrees between rays, down to 0.1 (3600 rays)
+};
+
+struct OffsetLineResult
+{
+    cv::Point start,end;
+    bool origin;                        // the AB line itself, not drawn again
+    std::vector<cv::Point3f> edges;     // x,y image coordinates, z 1 = up slope, 2 = down slope
+};
+
+// Seconds spent in each part of one measure() call.
+struct MeasureTiming
+{
+    MeasureTiming();
+
+    double smooth;      // blur cache fills (zero when the cache already had it)
+    double sample;      // line iteration, profile sampling, 1-D smoothing, persistence
+    double edges;       // peaks, spline edge search, offset line edges
+};
+
+struct MeasureResult
+{
+    MeasureResult();
+
+    MeasureParams params;
+    bool cancelled;                     // stopped before it finished, nothing else is set
+
+    std::vector<double> profile;        // AB line after smoothing, one value per pixel
+    std::vector<double> peakX,peakY;    // findPeak of "profile"
+    std::vector<cv::Point2f> edges;     // edges on the AB line, image coordinates
+    std::vector<OffsetLineResult> lines;
+
+    bool hasAccuracy;                   // the recursive backend was just selected
+    BlurAccuracy accuracy;
+
+    MeasureTiming timing;
+};
+
+// Polled between steps and once per offset line; returning true stops the
+// measurement and leaves the result marked cancelled.
+typedef std::function<bool()> CancelCheck;
+
+// Runs measurements on one image. It keeps the blur cache and the sampled
+// profiles of the last call and redoes only what the new parameters change,
+// so an amplitude change reuses every profile. Not thread safe itself;
+// use one per thread or serialise the calls.
+class MeasureCore
+{
+public:
+    MeasureCore();
+
+    MeasureResult measure(const cv::Mat &image, const MeasureParams &params,
+                          const CancelCheck &cancelled = CancelCheck());
+
+    // Same on a source, see imagesource.h. A decoded image is measured
+    // whole; of a mapped file only measureBounds() is read, with some room
+    // around it. That region is kept while later calls fit inside it, so
+    // the caches above carry over as they do for one image.
+    MeasureResult measure(const cv::Ptr<ImageSource> &source, const MeasureParams &params,
+                          const CancelCheck &cancelled = CancelCheck());
+
+private:
+    struct OffsetLine   //an offset line or ray, sampled once and re-measured when only the amplitude changes
+    {
+        cv::Point start,end;
+        bool origin;
+        std::vector<cv::Point2f> points;    // image position of every sample, empty for a batched line
+        cv::Point2f offset;                 // batched line: its samples are at m_pattern + offset,
+        cv::Point2f delta;                  // or, for a polar ray, at offset + i*delta
+        int row;                            // of m_lineProfiles, -1 for a line sampled alone into "points"
+        ProfileAnalysis profile;
+    };
+
+    bool sampleMain(const MeasureParams &params, const CancelCheck &cancelled, MeasureTiming &timing);
+    bool sampleOffsets(const MeasureParams &params, const CancelCheck &cancelled, MeasureTiming &timing);
+    void sampleParallel(const MeasureParams &params, const cv::Mat &blurred, const CancelCheck &cancelled);
+    void samplePolar(const MeasureParams &params, const cv::Mat &blurred, const CancelCheck &cancelled);
+    void profilesFromRows(const MeasureParams &params, const cv::Mat &blurred, const CancelCheck &cancelled);
+    cv::Point2f edgePosition(const OffsetLine &line, double x) const;
+    void measureOffsets(const MeasureParams &params, const CancelCheck &cancelled, MeasureResult &result) const;
+    void lineProfile(const MeasureParams &params, const cv::Mat &blurred, cv::Point2f a, cv::Point2f b,
+                     std::vector<cv::Point2f> &points, std::vector<double> &axisY) const;
+    cv::Mat smoothed(const MeasureParams &params, const cv::Rect &bounds);
+
+    cv::Mat m_image;
+    BlurCache m_blurCache;
+    int m_backend;                  // backend of the last finished call
+    MeasureParams m_profileFor;     // parameters m_points and m_profile were sampled with
+    MeasureParams m_linesFor;       // and m_lines
+    bool m_profileValid,m_linesValid;
+    bool m_accuracyValid;           // m_accuracy is of this image, for m_accuracy.kernel and this grey level
+    double m_accuracyGreyLevel;
+    BlurAccuracy m_accuracy;
+    std::vector<cv::Point2f> m_points;
+    ProfileAnalysis m_profile;
+    std::vector<OffsetLine> m_lines;
+    std::vector<cv::Point2f> m_pattern;     // sample positions shared by the batched lines, relative to their start
+    cv::Mat m_stripRows,m_lineProfiles;     // batched samples, reused between calls
+    PolarSampler m_polar;                   // remap tables of the rays
+    MeasureParams m_polarFor;               // smoothing of the source m_polar last converted
+
+    cv::Ptr<ImageSource> m_source;          // of the last measure(source), keeps its mapping alive
+    cv::Rect m_region;                      // part of it in m_regionPixels
+    cv::Mat m_regionPixels;
+};
+
+// Part of the image a measurement with "params" reads: the lines or rays,
+// the strip and interpolation support around them and, when the image is
+// smoothed, the kernel's reach around that. Not clipped to the image;
+// empty for ImageOnly.
+cv::Rect measureBounds(const MeasureParams &params);
+
+// Grey levels of an image of "depth" per 8-bit grey level, which the
+// amplitude threshold is given in: 1 for CV_8U, full scale / 255 for
+// CV_16U with "bitDepth" significant bits (all 16 when 0), 1/255 for
+// CV_32F, whose full scale is 1. One amplitude then finds the same edges
+// whatever the sensor's bit depth.
+double amplitudeScale(int depth, int bitDepth);
+
+// Peaks of a profile whose persistence was computed by setProfile.
+void findPeak(const ProfileAnalysis &profile, std::vector<double> &outputX, std::vector<double> &outputY, double distanceAmpi);
+
+// Steepest point between each pair of neighbouring peaks: x is the sub-sample
+// index along the profile, y the value there, z 1 = up slope, 2 = down slope.
+std::vector<cv::Point3d> ffSlope(const ProfileAnalysis &profile, double lengthAmpi, bool analytic);
+
+std::vector<double> linspace(double a, double b, int n);
+
+// Lines parallel to AB, "num" on each side "val" pixels apart, from the
+// farthest on the left of A->B to the farthest on the right. "bounds" is
+// the rectangle covering all of them. Line n is AB moved (num - n) * val
+// pixels along lineNormal(a, b), its ends rounded to the nearest pixel.
+void parallelLines(cv::Point2f a, cv::Point2f b, int num, int val,
+                   std::vector<cv::Point> &starts, std::vector<cv::Point> &ends,
+                   std::vector<bool> &origin, cv::Rect &bounds);
+
+// Rays from A with the length of AB, the first one AB itself, then "num"
+// more every "degree" degrees, clockwise on screen.
+void rayLines(cv::Point a, cv::Point b, int num, double degree,
+              std::vector<cv::Point> &ends, std::vector<bool> &origin, cv::Rect &bounds);
+
+// Line through the last edge of every line whose last edge has "slopeType",
+// as the two end points drawn by the dialog. False with fewer than 3 lines
+// or 2 points.
+bool fitEdgeLine(const std::vector< std::vector<cv::Point3f> > &lines, int slopeType,
+                 cv::Point &p1, cv::Point &p2);
+
+// Smallest circle around the same points.
+bool fitEdgeCircle(const std::vector< std::vector<cv::Point3f> > &lines, int slopeType,
+                   cv::Point2f &center, float &radius);
+
+#endif // MEASURECORE_H
@@ -0,0 +1,39 @@
+# Measurement core: smoothing, profile sampling, persistence, edge search
+# and fitting, with no Qt. Compiled into the dialog and into measurecore.pro.
+
+CONFIG += c++11
+INCLUDEPATH += $$PWD
+
+# diagnostic output, see measurelog.h: per-edge dumps in debug builds,
+# errors only in release
+CONFIG(debug, debug|release): DEFINES += MEASURE_LOG_LEVEL=3
+else: DEFINES += MEASURE_LOG_LEVEL=1
+
+SOURCES += \
+    $$PWD/measurecore.cpp \
+    $$PWD/blurcache.cpp \
+    $$PWD/recursivegaussian.cpp \
+    $$PWD/profilesmooth.cpp \
+    $$PWD/profileanalysis.cpp \
+    $$PWD/linesampler.cpp \
+    $$PWD/polarsampler.cpp \
+    $$PWD/imagesource.cpp \
+    $$PWD/measurerecipe.cpp \
+    $$PWD/resultsink.cpp
+
+HEADERS += \
+    $$PWD/measurecore.h \
+    $$PWD/persistence1d.hpp \
+    $$PWD/spline.h \
+    $$PWD/blurcache.h \
+    $$PWD/recursivegaussian.h \
+    $$PWD/profilesmooth.h \
+    $$PWD/profileanalysis.h \
+    $$PWD/linesampler.h \
+    $$PWD/polarsampler.h \
+    $$PWD/imagesource.h \
+    $$PWD/measurerecipe.h \
+    $$PWD/resultsink.h \
+    $$PWD/measurelog.h
+
+include($$PWD/opencv.pri)
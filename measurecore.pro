@@ -0,0 +1,14 @@
+#-------------------------------------------------
+#
+# Headless measurement library: no QtCore, no QtWidgets, no display.
+# Link it from batch tools and tests; see measurecore.h.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = measurecore
+TEMPLATE = lib
+CONFIG += staticlib
+
+include(measurecore.pri)
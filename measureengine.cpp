@@ -0,0 +1,84 @@
+#include "measureengine.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+
+MeasureEngine::MeasureEngine(QObject *parent) :
+    QObject(parent),
+    m_generation(0),
+    m_hasPending(false),
+    m_running(false),
+    m_runningId(0),
+    m_processed(0),
+    m_dropped(0)
+{
+    m_pool.setMaxThreadCount(1);
+
+    m_startTimer.setSingleShot(true);
+    m_startTimer.setInterval(0);
+    connect(&m_startTimer, SIGNAL(timeout()), this, SLOT(startPending()));
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(jobFinished()));
+}
+
+MeasureEngine::~MeasureEngine()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void MeasureEngine::setSource(const cv::Ptr<ImageSource> &source)
+{
+    m_nextSource = source;
+}
+
+void MeasureEngine::cancel()
+{
+    if(m_hasPending){
+        m_hasPending = false;
+        m_dropped++;
+    }
+    m_generation.fetchAndAddOrdered(1);
+}
+
+void MeasureEngine::submit(const MeasureParams &params)
+{
+    if(m_hasPending)
+        m_dropped++;    //overwritten before it ever ran
+    m_pending = params;
+    m_hasPending = true;
+
+    m_generation.fetchAndAddOrdered(1);   //the running job is out of date, let it stop early
+    if(!m_running)
+        m_startTimer.start();
+}
+
+void MeasureEngine::startPending()
+{
+    if(m_running || !m_hasPending)
+        return;
+
+    m_hasPending = false;
+    m_running = true;
+    m_runningId = m_generation.loadAcquire();
+    m_watcher.setFuture(QtConcurrent::run(&m_pool, this, &MeasureEngine::run, m_nextSource, m_pending, m_runningId));
+}
+
+void MeasureEngine::jobFinished()
+{
+    m_running = false;
+
+    MeasureResult result = m_watcher.result();
+    if(!result.cancelled && !cancelled(m_runningId)){
+        m_processed++;
+        emit resultReady(result);
+    }
+    else{
+        m_dropped++;
+    }
+
+    startPending();    //the newest parameters submitted while this one ran
+}
+
+MeasureResult MeasureEngine::run(const cv::Ptr<ImageSource> &source, const MeasureParams &params, int id)
+{
+    return m_core.measure(source, params, [this, id](){ return cancelled(id); });
+}
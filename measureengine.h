@@ -0,0 +1,72 @@
+#ifndef MEASUREENGINE_H
+#define MEASUREENGINE_H
+
+#include "measurecore.h"
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QThreadPool>
+#include <QTimer>
+#include <QFutureWatcher>
+
+#include <opencv2/core/core.hpp>
+
+// Runs measurements on a background thread. Every submit() supersedes the
+// job still running: it is told to stop at its next checkpoint and its
+// result is dropped, so only the newest parameters ever reach the UI.
+//
+// Submissions are coalesced, latest value wins. At most one job runs and
+// one set of parameters waits; a newer submit() overwrites the waiting one
+// instead of queueing another job. A job is only started from the event
+// loop, so every change made while handling one event (a slider that
+// resets two others, say) ends up in the same job.
+//
+// Jobs run one at a time on a private single-thread pool, each a
+// MeasureCore::measure() call on the engine's core. That keeps the core's
+// caches owned by one thread without locks; inside a job the per-line work
+// still fans out through cv::parallel_for_.
+class MeasureEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MeasureEngine(QObject *parent = 0);
+    ~MeasureEngine();   // cancels and waits for the running job
+
+    void setSource(const cv::Ptr<ImageSource> &source);    // used by the next job that starts
+    void submit(const MeasureParams &params);
+    void cancel();                          // also forgets the waiting parameters
+
+    // Load counters: submissions that produced a result, and those that
+    // were overwritten while waiting or cancelled while running.
+    int processed() const { return m_processed; }
+    int dropped() const { return m_dropped; }
+
+signals:
+    void resultReady(const MeasureResult &result);  // on the thread the engine lives in
+
+private slots:
+    void startPending();
+    void jobFinished();
+
+private:
+    bool cancelled(int id) const { return m_generation.loadAcquire() != id; }
+    MeasureResult run(const cv::Ptr<ImageSource> &source, const MeasureParams &params, int id);
+
+    QThreadPool m_pool;
+    QAtomicInt m_generation;    // id of the newest job, a job whose id differs is cancelled
+    cv::Ptr<ImageSource> m_nextSource;     // GUI side copy handed to each job
+
+    // GUI thread side of the scheduling
+    QTimer m_startTimer;        // zero timeout, starts the waiting job from the event loop
+    QFutureWatcher<MeasureResult> m_watcher;
+    MeasureParams m_pending;
+    bool m_hasPending;
+    bool m_running;
+    int m_runningId;
+    int m_processed,m_dropped;
+
+    MeasureCore m_core;         // only touched by the job thread
+};
+
+#endif // MEASUREENGINE_H
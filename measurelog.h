@@ -0,0 +1,48 @@
+#ifndef MEASURELOG_H
+#define MEASURELOG_H
+
+#include <cstdio>
+
+// Diagnostic output with a compile-time level. A message above
+// MEASURE_LOG_LEVEL expands to nothing, arguments included, so the dumps in
+// the per-line and per-sample loops cost nothing in a release build.
+// measurecore.pri sets the level per build configuration; override it with
+// DEFINES += MEASURE_LOG_LEVEL=<n>.
+
+#define MEASURE_LOG_OFF     0
+#define MEASURE_LOG_ERROR   1
+#define MEASURE_LOG_INFO    2   // once per measurement: job counters, blur accuracy
+#define MEASURE_LOG_DEBUG   3   // once per edge: edge point dumps
+#define MEASURE_LOG_TRACE   4   // once per sample: peaks, resampled spline points, slopes
+
+#ifndef MEASURE_LOG_LEVEL
+#define MEASURE_LOG_LEVEL MEASURE_LOG_INFO
+#endif
+
+#define MEASURE_LOG_PRINT(...) (std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr))
+
+#if MEASURE_LOG_LEVEL >= MEASURE_LOG_ERROR
+#define MEASURE_ERROR(...) MEASURE_LOG_PRINT(__VA_ARGS__)
+#else
+#define MEASURE_ERROR(...) ((void)0)
+#endif
+
+#if MEASURE_LOG_LEVEL >= MEASURE_LOG_INFO
+#define MEASURE_INFO(...) MEASURE_LOG_PRINT(__VA_ARGS__)
+#else
+#define MEASURE_INFO(...) ((void)0)
+#endif
+
+#if MEASURE_LOG_LEVEL >= MEASURE_LOG_DEBUG
+#define MEASURE_DEBUG(...) MEASURE_LOG_PRINT(__VA_ARGS__)
+#else
+#define MEASURE_DEBUG(...) ((void)0)
+#endif
+
+#if MEASURE_LOG_LEVEL >= MEASURE_LOG_TRACE
+#define MEASURE_TRACE(...) MEASURE_LOG_PRINT(__VA_ARGS__)
+#else
+#define MEASURE_TRACE(...) ((void)0)
+#endif
+
+#endif // MEASURELOG_H
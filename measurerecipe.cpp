@@ -0,0 +1,192 @@
+#include "measurerecipe.h"
+
+#include <opencv2/core/core.hpp>
+
+namespace
+{
+
+const int recipeVersion = 1;
+
+bool fail(std::string *error, const std::string &message)
+{
+    if(error)
+        *error = message;
+    return false;
+}
+
+const char* offsetsName(MeasureParams::Offsets offsets)
+{
+    switch(offsets){
+    case MeasureParams::ParallelLines: return "lines";
+    case MeasureParams::Rays: return "rays";
+    default: return "none";
+    }
+}
+
+const char* samplingName(MeasureParams::Sampling sampling)
+{
+    switch(sampling){
+    case MeasureParams::Bilinear: return "bilinear";
+    case MeasureParams::Bicubic: return "bicubic";
+    default: return "pixel";
+    }
+}
+
+bool readInt(const cv::FileStorage &fs, const char *name, int low, int high, int &value, std::string *error)
+{
+    cv::FileNode node = fs[name];
+    if(node.empty() || !node.isInt())
+        return fail(error, std::string("recipe field \"") + name + "\" is missing or not an integer");
+    int v = (int)node;
+    if(v < low || v > high)
+        return fail(error, std::string("recipe field \"") + name + "\" is out of range");
+    value = v;
+    return true;
+}
+
+bool readDouble(const cv::FileStorage &fs, const char *name, double low, double high, double &value, std::string *error)
+{
+    cv::FileNode node = fs[name];
+    if(node.empty() || !node.isReal())
+        return fail(error, std::string("recipe field \"") + name + "\" is missing or not a real number");
+    double v = (double)node;
+    if(v < low || v > high)
+        return fail(error, std::string("recipe field \"") + name + "\" is out of range");
+    value = v;
+    return true;
+}
+
+// sub-pixel points, both coordinates real
+bool readPoint(const cv::FileStorage &fs, const char *name, cv::Point2f &value, std::string *error)
+{
+    cv::FileNode node = fs[name];
+    if(!node.isSeq() || node.size() != 2 || !node[0].isReal() || !node[1].isReal())
+        return fail(error, std::string("recipe field \"") + name + "\" must be [ x, y ], both real");
+    value = cv::Point2f((float)node[0], (float)node[1]);
+    return true;
+}
+
+} // namespace
+
+MeasureRecipe::MeasureRecipe() :
+    slopeType(2)
+{
+    params.stage = MeasureParams::Edges;
+}
+
+bool loadRecipe(const std::string &path, MeasureRecipe &recipe, std::string *error)
+{
+    try{
+        cv::FileStorage fs(path, cv::FileStorage::READ);
+        if(!fs.isOpened())
+            return fail(error, "cannot open recipe " + path);
+
+        int version = 0;
+        if(!readInt(fs, "version", 1, recipeVersion, version, error))
+            return false;
+
+        MeasureRecipe r;
+        MeasureParams &p = r.params;
+        int flag;
+        if(!readPoint(fs, "a", p.a, error) || !readPoint(fs, "b", p.b, error)
+                || !readInt(fs, "kernel", 1, 255, p.kernel, error)
+                || !readInt(fs, "width", 1, 64, p.width, error)
+                || !readInt(fs, "amplitude", 0, 255, p.amplitude, error)
+                || !readInt(fs, "offsetNum", 0, 3600, p.offsetNum, error)
+                || !readInt(fs, "offsetVal", 0, 4096, p.offsetVal, error)
+                || !readDouble(fs, "rayDegree", 0, 360, p.rayDegree, error)
+                || !readInt(fs, "slopeType", 1, 2, r.slopeType, error))
+            return false;
+        if(p.kernel%2 == 0)
+            return fail(error, "recipe field \"kernel\" must be odd");
+
+        if(!readInt(fs, "roiSmooth", 0, 1, flag, error))
+            return false;
+        p.roiSmooth = flag;
+        if(!readInt(fs, "profileStage", 0, 1, flag, error))
+            return false;
+        p.profileStage = flag;
+        if(!readInt(fs, "analytic", 0, 1, flag, error))
+            return false;
+        p.analytic = flag;
+
+        std::string backend = (std::string)fs["backend"];
+        if(backend == "gaussian")
+            p.backend = BlurCache::Gaussian;
+        else if(backend == "recursive")
+            p.backend = BlurCache::Recursive;
+        else
+            return fail(error, "recipe field \"backend\" must be gaussian or recursive");
+
+        std::string offsets = (std::string)fs["offsets"];
+        if(offsets == "none")
+            p.offsets = MeasureParams::NoOffsets;
+        else if(offsets == "lines")
+            p.offsets = MeasureParams::ParallelLines;
+        else if(offsets == "rays")
+            p.offsets = MeasureParams::Rays;
+        else
+            return fail(error, "recipe field \"offsets\" must be none, lines or rays");
+
+        std::string sampling = (std::string)fs["sampling"];
+        if(sampling == "pixel")
+            p.sampling = MeasureParams::PixelSteps;
+        else if(sampling == "bilinear")
+            p.sampling = MeasureParams::Bilinear;
+        else if(sampling == "bicubic")
+            p.sampling = MeasureParams::Bicubic;
+        else
+            return fail(error, "recipe field \"sampling\" must be pixel, bilinear or bicubic");
+        if(!readInt(fs, "stripMedian", 0, 1, flag, error))
+            return false;
+        p.stripMedian = flag;
+        if(!readDouble(fs, "step", 0.05, 16, p.step, error)
+                || !readInt(fs, "bitDepth", 0, 16, p.bitDepth, error))
+            return false;
+
+        if(p.offsets == MeasureParams::ParallelLines && p.offsetVal <= 0)
+            return fail(error, "recipe field \"offsetVal\" must be > 0 for lines");
+        if(p.offsets == MeasureParams::Rays && p.rayDegree <= 0)
+            return fail(error, "recipe field \"rayDegree\" must be > 0 for rays");
+
+        recipe = r;
+    }
+    catch(const cv::Exception &e){  //malformed file
+        return fail(error, e.what());
+    }
+    return true;
+}
+
+bool saveRecipe(const std::string &path, const MeasureRecipe &recipe, std::string *error)
+{
+    try{
+        cv::FileStorage fs(path, cv::FileStorage::WRITE);
+        if(!fs.isOpened())
+            return fail(error, "cannot write recipe " + path);
+
+        const MeasureParams &p = recipe.params;
+        fs << "version" << recipeVersion;
+        fs << "a" << "[" << p.a.x << p.a.y << "]";
+        fs << "b" << "[" << p.b.x << p.b.y << "]";
+        fs << "kernel" << p.kernel;
+        fs << "backend" << (p.backend == BlurCache::Recursive ? "recursive" : "gaussian");
+        fs << "roiSmooth" << (int)p.roiSmooth;
+        fs << "profileStage" << (int)p.profileStage;
+        fs << "width" << p.width;
+        fs << "stripMedian" << (int)p.stripMedian;
+        fs << "amplitude" << p.amplitude;
+        fs << "bitDepth" << p.bitDepth;
+        fs << "analytic" << (int)p.analytic;
+        fs << "sampling" << samplingName(p.sampling);
+        fs << "step" << p.step;
+        fs << "offsets" << offsetsName(p.offsets);
+        fs << "offsetNum" << p.offsetNum;
+        fs << "offsetVal" << p.offsetVal;
+        fs << "rayDegree" << p.rayDegree;
+        fs << "slopeType" << recipe.slopeType;
+    }
+    catch(const cv::Exception &e){
+        return fail(error, e.what());
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef MEASURERECIPE_H
+#define MEASURERECIPE_H
+
+#include "measurecore.h"
+
+#include <string>
+
+// A complete measurement setup (AB line, smoothing, amplitude, edge mode,
+// offset lines or rays, fitted slope type) stored with cv::FileStorage, so
+// the file is YAML, XML or JSON depending on its extension. The dialog
+// saves and loads it, measurecli replays it on a folder of images.
+//
+//   %YAML:1.0
+//   version: 1
+//   a: [ 120., 200. ]
+//   b: [ 480., 210.5 ]
+//   kernel: 5
+//   ...
+//   offsets: lines       # none, lines or rays
+struct MeasureRecipe
+{
+    MeasureRecipe();
+
+    MeasureParams params;   // "stage" is always Edges on load
+    int slopeType;          // edge type the line or circle is fitted to, 1 = up, 2 = down
+};
+
+// Every field saveRecipe writes is required, and the real ones (a, b,
+// step, rayDegree) must be written as reals. False, with a message in
+// "error", when the file cannot be opened or a field is missing, of the
+// wrong type or out of range. "recipe" is left untouched then.
+bool loadRecipe(const std::string &path, MeasureRecipe &recipe, std::string *error = 0);
+bool saveRecipe(const std::string &path, const MeasureRecipe &recipe, std::string *error = 0);
+
+#endif // MEASURERECIPE_H
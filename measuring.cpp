@@ -1,196 +1,40 @@
 #include "measuring.h"
 #include "ui_measuring.h"
 #include "qcustomplot.h"
-#include "persistence1d.hpp"
-#include "spline.h"
+#include "measurelog.h"
+#include "resultsink.h"
+#include "overlayview.h"
 
-#include <QPixmap>
 #include <QString>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QSignalBlocker>
 #include <iostream>
 #include <vector>
-#include <QDebug>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
-
-#define PI 3.14159
-
-std::vector<cv::Point> *linePoints,         //point from mouse move
-*smooth_linePoints;  //point that smoothed
-std::vector<std::vector<cv::Point3i>> result_line;
-
-cv::Point pre_A,pre_B,A,B,line_begin;
-
-int MAX_KERNEL_LENGTH;
-
-
-inline QImage  cvMatToQImage( const cv::Mat &inMat )
-{
-    switch ( inMat.type() )
-    {
-    // 8-bit, 4 channel
-    case CV_8UC4:
-    {
-        QImage image( inMat.data,
-                      inMat.cols, inMat.rows,
-                      static_cast<int>(inMat.step),
-                      QImage::Format_ARGB32 );
-
-        return image;
-    }
-
-        // 8-bit, 3 channel
-    case CV_8UC3:
-    {
-        QImage image( inMat.data,
-                      inMat.cols, inMat.rows,
-                      static_cast<int>(inMat.step),
-                      QImage::Format_RGB888 );
-
-        return image.rgbSwapped();
-    }
-
-        // 8-bit, 1 channel
-    case CV_8UC1:
-    {
-        QImage image( inMat.data,
-                      inMat.cols, inMat.rows,
-                      static_cast<int>(inMat.step),
-                      QImage::Format_Grayscale8 );
-        static QVector<QRgb>  sColorTable;
-
-        // only create our color table the first time
-        if ( sColorTable.isEmpty() )
-        {
-            sColorTable.resize( 256 );
-
-            for ( int i = 0; i < 256; ++i )
-            {
-                sColorTable[i] = qRgb( i, i, i );
-            }
-        }
-
-        image.setColorTable( sColorTable );
-
-        return image;
-    }
-
-    default:
-
-        break;
-    }
-
-    return QImage();
-}
-
-inline QPixmap cvMatToQPixmap( const cv::Mat &inMat )
-{
-    return QPixmap::fromImage( cvMatToQImage( inMat ) );
-}
-
-inline cv::Mat QImageToCvMat( const QImage &inImage, bool inCloneImageData = true )
-{
-    switch ( inImage.format() )
-    {
-    // 8-bit, 4 channel
-    case QImage::Format_ARGB32:
-    case QImage::Format_ARGB32_Premultiplied:
-    {
-        cv::Mat  mat( inImage.height(), inImage.width(),
-                      CV_8UC4,
-                      const_cast<uchar*>(inImage.bits()),
-                      static_cast<size_t>(inImage.bytesPerLine())
-                      );
-
-        return (inCloneImageData ? mat.clone() : mat);
-    }
-
-        // 8-bit, 3 channel
-    case QImage::Format_RGB32:
-    {
-        if ( !inCloneImageData )
-        {
-            qWarning() << "ASM::QImageToCvMat() - Conversion requires cloning so we don't modify the original QImage data";
-        }
-
-        cv::Mat  mat( inImage.height(), inImage.width(),
-                      CV_8UC4,
-                      const_cast<uchar*>(inImage.bits()),
-                      static_cast<size_t>(inImage.bytesPerLine())
-                      );
-
-        cv::Mat  matNoAlpha;
-
-        cv::cvtColor( mat, matNoAlpha, cv::COLOR_BGRA2BGR );   // drop the all-white alpha channel
-
-        return matNoAlpha;
-    }
-
-        // 8-bit, 3 channel
-    case QImage::Format_RGB888:
-    {
-        if ( !inCloneImageData )
-        {
-            qWarning() << "ASM::QImageToCvMat() - Conversion requires cloning so we don't modify the original QImage data";
-        }
-
-        QImage   swapped = inImage.rgbSwapped();
-
-        return cv::Mat( swapped.height(), swapped.width(),
-                        CV_8UC3,
-                        const_cast<uchar*>(swapped.bits()),
-                        static_cast<size_t>(swapped.bytesPerLine())
-                        ).clone();
-    }
-
-        // 8-bit, 1 channel
-    case QImage::Format_Indexed8:
-    {
-        cv::Mat  mat( inImage.height(), inImage.width(),
-                      CV_8UC1,
-                      const_cast<uchar*>(inImage.bits()),
-                      static_cast<size_t>(inImage.bytesPerLine())
-                      );
-
-        return (inCloneImageData ? mat.clone() : mat);
-    }
-
-    default:
-        qWarning() << "ASM::QImageToCvMat() - QImage format not handled in switch:" << inImage.format();
-        break;
-    }
-
-    return cv::Mat();
-}
-
-inline cv::Mat QPixmapToCvMat( const QPixmap &inPixmap, bool inCloneImageData = true )
+// image after "path" in its folder, by name; empty at the last one
+QString nextImagePath(const QString &path)
 {
-    return QImageToCvMat( inPixmap.toImage(), inCloneImageData );
-}
-
-int** cvMatToArrays(const cv::Mat &img){
-    int row = img.rows;
-    int col = img.cols;
-    int** arr=0;
-    arr=new int*[row];
-
-    for (int x = 0;x < row; x++){
-        arr[x]=new int[col];
-        for (int y = 0; y < col; y++){
-            if(img.at<uchar>(x,y) == 255)
-                arr[x][y] = 1;
-            else
-                arr[x][y] = 0;
-
-            //arr[x][y] = img.at<uchar>(x,y);
-        }
-    }
-    return arr;
+    if(path.isEmpty())
+        return QString();
+    QFileInfo info(path);
+    QStringList filters;
+    filters << "*.png" << "*.jpg" << "*.jpeg" << "*.bmp" << "*.tif" << "*.tiff" << "*.pgm" << "*.raw";
+    QStringList names = info.dir().entryList(filters, QDir::Files, QDir::Name);
+    int i = names.indexOf(info.fileName());
+    if(i < 0 || i+1 >= names.size())
+        return QString();
+    return info.dir().filePath(names.at(i+1));
 }
 
 
@@ -201,7 +45,7 @@ measuring::measuring(QWidget *parent) :
     ui->setupUi(this);
 
     ui->circle_setting->setEnabled(false);
-    ui->circle_offset_radL->setText(QString::number(ui->circle_offsetDeg->minimum()));
+    ui->circle_offset_radL->setText(QString::number(ui->circle_offsetDeg->value()/10.0, 'f', 1));
     ui->circle_offset_numL->setText(QString::number(ui->circle_offsetNum->minimum()));
 
     ui->amplitude_value->setText(QString::number(ui->amplitudeSlider->minimum()));
@@ -210,33 +54,30 @@ measuring::measuring(QWidget *parent) :
     ui->offset_disL->setText(QString::number(ui->offsetVal->minimum()));
 
 
-    MAX_KERNEL_LENGTH = ui->smoothSlider->minimum();
     mousePressed = false;
+    slopeType = 2;
+    reloadStage = MeasureParams::ImageOnly;
+
+    connect(&engine, &MeasureEngine::resultReady, this, &measuring::showResult);
+    connect(&loader, &ImageLoader::previewReady, this, &measuring::showPreview);
+    connect(&loader, &ImageLoader::imageReady, this, &measuring::imageLoaded);
+    connect(&loader, &ImageLoader::overviewReady, this, &measuring::showOverview);
+    connect(&loader, &ImageLoader::loadFailed, this, &measuring::imageLoadFailed);
+    ui->loadProgress->hide();
 
 }
 
 void measuring::mousePressEvent(QMouseEvent *event){
 
-    if(!image.empty()){
-
-        tmp_pix = mPix;
-
-        int dis_x = ( ui->imgShow->width() - tmp_pix.width() ) / 2;
-        int dis_y = ( ui->imgShow->height() - tmp_pix.height() ) / 2;
-        int x = event->pos().x() - ui->imgShow->pos().x() - dis_x;
-        int y = event->pos().y() - ui->imgShow->pos().y() - dis_y;
+    if(source){
 
-        if( x < 0 || y < 0 ||
-                x > tmp_pix.width() ||
-                y > tmp_pix.height())
-        {}
-        else
+        QPointF p;
+        if(event->button() == Qt::LeftButton && ui->imgShow->toImage(event->pos() - ui->imgShow->pos(), p))
         {
-            ui->imgShow->setPixmap(tmp_pix);
-            ui->imgShow->setAlignment(Qt::AlignCenter);
+            ui->imgShow->clearOverlays();
 
-            line_begin.x=x;
-            line_begin.y=y;
+            line_begin.x=p.x();
+            line_begin.y=p.y();
             mousePressed = true;
         }
     }
@@ -244,78 +85,48 @@ void measuring::mousePressEvent(QMouseEvent *event){
 
 void measuring::mouseMoveEvent(QMouseEvent *event){
 
-    if(!image.empty() && mousePressed){
-        ui->imgShow->setPixmap(mPix);
-        ui->imgShow->setAlignment(Qt::AlignCenter);
-        linePix = mPix;
-
-        int dis_x = ( ui->imgShow->width() - ui->imgShow->pixmap()->width() ) / 2;
-        int dis_y = ( ui->imgShow->height() - ui->imgShow->pixmap()->height() ) / 2;
-        int x = event->pos().x() - ui->imgShow->pos().x() - dis_x;
-        int y = event->pos().y() - ui->imgShow->pos().y() - dis_y;
-
-        if( x < 0 || y < 0 ||
-                x > ui->imgShow->pixmap()->width() ||
-                y > ui->imgShow->pixmap()->height() )
+    //only the rubber band changes, the view repaints the strip it covers
+    if(source && mousePressed){
+        QPointF p;
+        if(!ui->imgShow->toImage(event->pos() - ui->imgShow->pos(), p))
         {
             line_begin.x = NULL;
             line_begin.y = NULL;
             mousePressed = false;
+            ui->imgShow->clearRubberBand();
         }
         else
         {
-            mLine.setLine(line_begin.x,line_begin.y,x,y);
-
-            QPainter *paint = new QPainter(&linePix);
-            paint->setPen(QColor(255,34,255,255));
-            paint->drawLine(mLine);
-            delete paint;
-            ui->imgShow->setPixmap(linePix);
-            ui->imgShow->setAlignment(Qt::AlignCenter);
+            mLine.setLine(line_begin.x,line_begin.y,p.x(),p.y());
+            ui->imgShow->setRubberBand(mLine);
         }
     }
 }
 
 void measuring::mouseReleaseEvent(QMouseEvent *event){
 
-    if(!image.empty() && mousePressed){
-        ui->imgShow->setPixmap(cvMatToQPixmap(image));
-        ui->imgShow->setAlignment(Qt::AlignCenter);
-        linePix = mPix;
+    if(source && mousePressed){
+        ui->imgShow->clearRubberBand();
 
-        int dis_x = ( ui->imgShow->width() - ui->imgShow->pixmap()->width() ) / 2;
-        int dis_y = ( ui->imgShow->height() - ui->imgShow->pixmap()->height() ) / 2;
-        int x = event->pos().x() - ui->imgShow->pos().x() - dis_x;
-        int y = event->pos().y() - ui->imgShow->pos().y() - dis_y;
-
-        if( x < 0 || y < 0 ||
-                x > ui->imgShow->pixmap()->width() ||
-                y > ui->imgShow->pixmap()->height() )
+        QPointF p;
+        if(!ui->imgShow->toImage(event->pos() - ui->imgShow->pos(), p))
         {}
         else
         {
-            QPainter *paint = new QPainter(&linePix);
-            paint->setPen(QColor(0,255,255,255));
-
-            mLine.setLine(line_begin.x,line_begin.y,x,y);
-            paint->drawLine(mLine);
-            paint->setBrush(QBrush(Qt::red));     //--line header-|
-            paint->drawEllipse(QPoint(x,y),3,3);    //--------------|
+            mLine.setLine(line_begin.x,line_begin.y,p.x(),p.y());
+            ui->imgShow->setLine(mLine);
 
             pre_A.x=mLine.x1();
             pre_A.y=mLine.y1();
             pre_B.x=mLine.x2();
             pre_B.y=mLine.y2();
-            ui->x1->setText(QString::number(mLine.x1()));
-            ui->y1->setText(QString::number(mLine.y1()));
-            ui->x2->setText(QString::number(mLine.x2()));
-            ui->y2->setText(QString::number(mLine.y2()));
+            ui->x1->setText(QString::number(mLine.x1(),'f',2));
+            ui->y1->setText(QString::number(mLine.y1(),'f',2));
+            ui->x2->setText(QString::number(mLine.x2(),'f',2));
+            ui->y2->setText(QString::number(mLine.y2(),'f',2));
 
             ui->showGraph->setEnabled(true);
 
-            delete paint;
-            ui->imgShow->setPixmap(linePix);
-            ui->imgShow->setAlignment(Qt::AlignCenter);
             // }
             /*else if(operation == "circle"){ //more calculate in Circle operation
                 cv::Point tmp;
@@ -370,25 +181,109 @@ void measuring::on_showImg_clicked()
 {
     //QString path = "E://5.jpg";//ui->imgPath->text();
     QString path = QFileDialog::getOpenFileName(this,tr("Open File"),"E://ProjectPictures");
-    if(!path.isEmpty()){
-        /// UI:control ///
-        ui->showGraph->setEnabled(false);
-        ui->smoothSlider->setEnabled(false);
-        ui->amplitudeSlider->setEnabled(false);
-        ui->offsetVal->setEnabled(false);
-        ui->offsetNum->setEnabled(false);
+    if(path.isEmpty())
+        return;
+
+    if(QFileInfo(path).suffix().toLower() == "raw"){
+        //headerless, the layout has to come from the user; kept for the next frames
+        bool ok = false;
+        QString format = QInputDialog::getText(this, tr("Raw Frame"), tr("Frame size, WIDTHxHEIGHT[x16][+HEADER], x16 for 16-bit samples:"),
+                                               QLineEdit::Normal, rawFormat, &ok);
+        if(!ok)
+            return;
+        RawFormat raw;
+        if(!parseRawFormat(format.trimmed().toStdString(), raw)){
+            QMessageBox::warning(this, tr("Raw Frame"), tr("%1 is not a frame size like 16384x65536.").arg(format));
+            return;
+        }
+        rawFormat = format.trimmed();
+        loader.setRawFormat(raw);
+    }
+    startLoading(path, false);
+}
 
-        ui->Operation->setEnabled(true);
-        //////////////////
+void measuring::on_nextImage_clicked()
+{
+    //the same line and settings on the next image of the folder, which
+    //was decoded in the background while this one was measured
+    QString next = nextImagePath(imagePath);
+    if(!next.isEmpty())
+        startLoading(next, params.stage != MeasureParams::ImageOnly);
+}
 
-        image = cv::imread(path.toStdString(), 0);
+void measuring::startLoading(const QString &path, bool keepMeasurement)
+{
+    /// UI:control ///
+    //locked until the full resolution image is in, a preview is only for looking
+    ui->showGraph->setEnabled(false);
+    ui->smoothSlider->setEnabled(false);
+    ui->amplitudeSlider->setEnabled(false);
+    ui->offsetVal->setEnabled(false);
+    ui->offsetNum->setEnabled(false);
+
+    ui->Operation->setEnabled(false);
+    ui->loadRecipe->setEnabled(false);
+    ui->saveRecipe->setEnabled(false);
+    ui->exportResult->setEnabled(false);
+    ui->nextImage->setEnabled(false);
+    ui->loadProgress->show();
+    //////////////////
 
-        mPix = cvMatToQPixmap(image);
+    engine.cancel();    //a job of the old image must not draw on the new one
+    source.release();   //no line tools on the old image meanwhile
+    imagePath = path;
+    reloadStage = keepMeasurement ? params.stage : MeasureParams::ImageOnly;
+    params.stage = MeasureParams::ImageOnly;    //no slot submits a job until the image is in
+    loader.load(path);
+}
 
-        ui->imgShow->setPixmap(mPix);
-        ui->imgShow->setAlignment(Qt::AlignCenter);
-    }
+void measuring::showPreview(const QString &path, const ImageLoader::Display &preview, int factor)
+{
+    MEASURE_INFO("preview of %s, 1/%d size", path.toLocal8Bit().constData(), factor);
+    ui->imgShow->setPreview(preview.pyramid, preview.window, factor);
+}
+
+void measuring::imageLoaded(const QString &path, const cv::Ptr<ImageSource> &loaded, const ImageLoader::Display &display)
+{
+    ui->loadProgress->hide();
+    source = loaded;
+    engine.setSource(source);
+    ui->imgShow->setImage(source, display.pyramid, display.window);
+    ui->customPlot->yAxis->setRange(0,plotTop());     //the depth may differ from the last image's
+
+    ui->Operation->setEnabled(true);
+    ui->loadRecipe->setEnabled(true);
+
+    if(reloadStage != MeasureParams::ImageOnly){
+        //the measurement of the previous image, redone on this one
+        ui->imgShow->setLine(QLineF(A.x,A.y,B.x,B.y));
+        ui->showGraph->setEnabled(true);
+        ui->saveRecipe->setEnabled(true);
+        ui->smoothSlider->setEnabled(true);
+        ui->amplitudeSlider->setEnabled(true);
+        ui->offsetVal->setEnabled(true);
+        ui->offsetNum->setEnabled(true);
+        params.stage = reloadStage;
+        engine.submit(params);
+    }
+
+    //decoded while this one is measured
+    QString next = nextImagePath(path);
+    ui->nextImage->setEnabled(!next.isEmpty());
+    loader.prefetch(next);
+}
 
+void measuring::showOverview(const QString &path, const ImageLoader::Display &overview, int factor)
+{
+    MEASURE_INFO("overview of %s, 1/%d size", path.toLocal8Bit().constData(), factor);
+    ui->imgShow->setOverview(overview.pyramid, overview.window, factor);
+}
+
+void measuring::imageLoadFailed(const QString &path)
+{
+    ui->loadProgress->hide();
+    ui->nextImage->setEnabled(!nextImagePath(path).isEmpty());
+    QMessageBox::warning(this, tr("Open File"), tr("Cannot read %1 as an image.").arg(path));
 }
 
 void measuring::on_showGraph_clicked()
@@ -396,51 +291,55 @@ void measuring::on_showGraph_clicked()
     A=pre_A;
     B=pre_B;
 
-    cv::LineIterator it(image, A, B, 8 ,false);//'true' is left to right ,not order || 'false' A point to B point
-    linePoints = new std::vector<cv::Point>(it.count);
-    smooth_linePoints = new std::vector<cv::Point>(it.count);
+    params.stage = MeasureParams::Profile;  //raw profile until the smooth slider moves
+    params.a = A;
+    params.b = B;
+    params.kernel = 1;
+    params.offsets = MeasureParams::NoOffsets;
 
-    std::vector<double> axisX;
-    std::vector<double> axisY;
+    setupGraph();
+    submitMeasure();
 
-    for(int i = 0; i < it.count; i++, ++it)
-    {
-        linePoints->at(i) = it.pos();
-        smooth_linePoints->at(i) = it.pos();
-    }
+    /// UI:control ///
+    ui->saveRecipe->setEnabled(true);
+    ui->smoothSlider->setEnabled(true);
+    ui->amplitudeSlider->setEnabled(true);
+    ui->smoothSlider->setValue(ui->smoothSlider->minimum());
+    ui->amplitudeSlider->setValue(ui->amplitudeSlider->minimum());
+    ui->offsetVal->setValue(ui->offsetVal->minimum());
+    ui->offsetNum->setValue(ui->offsetNum->minimum());
+    /////////////////
 
-    for(int i =0;i<linePoints->size();i++){
-        axisX.push_back(i);                                     // point index
-        axisY.push_back(image.at<uchar>(linePoints->at(i)));    // pixel color
-        //qDebug() << re_linePoints->at(i).x << re_linePoints->at(i).y;
-    }
+}
 
+void measuring::setupGraph()
+{
+    ui->customPlot->clearGraphs();     //called again on every recipe load
     ui->customPlot->addGraph();
-    ui->customPlot->graph(0)->setData(QVector<double>::fromStdVector(axisX),QVector<double>::fromStdVector(axisY));
     ui->customPlot->xAxis->setLabel("Index of each point");
     ui->customPlot->yAxis->setLabel("Pixel Color");
-    ui->customPlot->xAxis->setRange(0,linePoints->size()-1);
-    ui->customPlot->yAxis->setRange(0,255);             //color 0-255
-    ui->customPlot->replot();
+    ui->customPlot->yAxis->setRange(0,plotTop());       //color 0-255, or the 16-bit or float range
 
     ui->customPlot->addGraph();
     ui->customPlot->graph(1)->setPen(QPen(QColor(255, 100, 0)));
     ui->customPlot->graph(1)->setLineStyle(QCPGraph::lsNone);
     ui->customPlot->graph(1)->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssDisc, 10));
+}
 
-    /// UI:control ///
-    ui->smoothSlider->setEnabled(true);
-    ui->amplitudeSlider->setEnabled(true);
-    ui->smoothSlider->setValue(ui->smoothSlider->minimum());
-    ui->amplitudeSlider->setValue(ui->amplitudeSlider->minimum());
-    ui->offsetVal->setValue(ui->offsetVal->minimum());
-    ui->offsetNum->setValue(ui->offsetNum->minimum());
-    /////////////////
-
+double measuring::plotTop() const
+{
+    int depth = source ? CV_MAT_DEPTH(source->type()) : CV_8U;
+    return 255 * amplitudeScale(depth, params.bitDepth);
 }
 
 void measuring::on_smoothSlider_valueChanged(int value)
 {
+    if(value%2!=0 && value!=1){ //Gaussian Smooth
+        params.kernel = value-2;    //only the largest kernel of the old 1..value loop was ever kept
+        params.stage = MeasureParams::Edges;
+    }
+    params.offsets = MeasureParams::NoOffsets;  //their profiles were smoothed with the old kernel
+
     /// UI:control ///
     if(ui->offsetVal->value() != ui->offsetVal->minimum())
         ui->offsetVal->setValue(ui->offsetVal->minimum());
@@ -451,387 +350,120 @@ void measuring::on_smoothSlider_valueChanged(int value)
     ui->offsetVal->setEnabled(true);
     //////////////////
 
-    if(value%2!=0 && value!=1){ //Gaussian Smooth
-        MAX_KERNEL_LENGTH = value;
-
-        for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 ){
-            cv::GaussianBlur(image,blur_img,cv::Size(i,i),0,0);
-        }
-
-        std::vector<double> axisX,axisY;
-        for(int i =0;i<linePoints->size();i++){
-            axisX.push_back(i);
-            axisY.push_back(blur_img.at<uchar>(linePoints->at(i)));
-            smooth_linePoints->at(i).x = i;
-            smooth_linePoints->at(i).y = blur_img.at<uchar>(linePoints->at(i));
-
-            //qDebug() << re_linePoints->at(i).x << re_linePoints->at(i).y;
-        }
-
-        //ui->customPlot->graph(0)->setData(QVector<double>::fromStdVector(axisX),QVector<double>::fromStdVector(axisY));
-        ui->customPlot->graph(0)->setData(QVector<double>::fromStdVector(axisX),QVector<double>::fromStdVector(axisY));
-        ui->customPlot->replot();
-
-        findPeak(axisY,axisX,axisY,ui->amplitudeSlider->value());
-
-        ui->customPlot->graph(1)->setData(QVector<double>::fromStdVector(axisX),QVector<double>::fromStdVector(axisY));
-        ui->customPlot->replot();
-
-        std::vector<double> smoothX,smoothY;
-        for(int i =0;i<smooth_linePoints->size();i++){
-            smoothX.push_back(smooth_linePoints->at(i).x);
-            smoothY.push_back(smooth_linePoints->at(i).y);
-        }
-
-        std::vector<cv::Point3i> ffPoints = ffSlope(smoothX,smoothY,ui->amplitudeSlider->value()); //ffSlope.x is *INDEX* for linePoints(from user)  ,ffSlope.y is PixColor
-        //for(int i =0;i<ffPoints.size();i++) qDebug() << ffPoints.at(i).x<< ffPoints.at(i).y;
-
-        pointPix = linePix;
-        QPainter *paint = new QPainter(&pointPix);
-        paint->setPen(QColor(0,0,255,255));
-        for(int i=0 ;i<ffPoints.size() ;i++){
-            mLine.setLine(linePoints->at(ffPoints.at(i).x).x-4,
-                             linePoints->at(ffPoints.at(i).x).y-4,
-                             linePoints->at(ffPoints.at(i).x).x+4,
-                             linePoints->at(ffPoints.at(i).x).y+4);
-            paint->drawLine(mLine);
-            mLine.setLine(linePoints->at(ffPoints.at(i).x).x+4,
-                              linePoints->at(ffPoints.at(i).x).y-4,
-                              linePoints->at(ffPoints.at(i).x).x-4,
-                              linePoints->at(ffPoints.at(i).x).y+4);
-            paint->drawLine(mLine);
-        }
-        delete paint;
-        ui->imgShow->setPixmap(pointPix);
-        ui->imgShow->setAlignment(Qt::AlignCenter);
-
-    }
+    submitMeasure();
 }
 
 void measuring::on_amplitudeSlider_valueChanged(int value)
 {
     /// UI:control ///
-    if(ui->offsetVal->value() != ui->offsetVal->minimum())
-        ui->offsetVal->setValue(ui->offsetVal->minimum());
-    else
-        ui->offsetNum->setValue(0);
-
     ui->offsetNum->setEnabled(true);
     ui->offsetVal->setEnabled(true);
     //////////////////
 
-    std::vector<double> smoothX,smoothY;
-    for(int i =0;i<smooth_linePoints->size();i++){
-        smoothX.push_back(smooth_linePoints->at(i).x);
-        smoothY.push_back(smooth_linePoints->at(i).y);
-    }
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
 
-    std::vector<double> axisX,axisY;
-    findPeak(smoothY,axisX,axisY,value);
-
-    ui->customPlot->graph(1)->setData(QVector<double>::fromStdVector(axisX),QVector<double>::fromStdVector(axisY));
-    ui->customPlot->replot();
-
-    std::vector<cv::Point3i> ffPoints = ffSlope(smoothX,smoothY,value);
-
-    pointPix = linePix;
-    QPainter *paint = new QPainter(&pointPix);
-    paint->setPen(QColor(0,0,255,255));
-    for(int i=0 ;i<ffPoints.size() ;i++){
-        mLine.setLine(linePoints->at(ffPoints.at(i).x).x-4,
-                         linePoints->at(ffPoints.at(i).x).y-4,
-                         linePoints->at(ffPoints.at(i).x).x+4,
-                         linePoints->at(ffPoints.at(i).x).y+4);
-        paint->drawLine(mLine);
-        mLine.setLine(linePoints->at(ffPoints.at(i).x).x+4,
-                          linePoints->at(ffPoints.at(i).x).y-4,
-                          linePoints->at(ffPoints.at(i).x).x-4,
-                          linePoints->at(ffPoints.at(i).x).y+4);
-        paint->drawLine(mLine);
-    }
-    delete paint;
-    ui->imgShow->setPixmap(pointPix);
-    ui->imgShow->setAlignment(Qt::AlignCenter);
+    //only the threshold and the edge step are redone, on the cached profiles
+    params.stage = MeasureParams::Edges;
+    submitMeasure();
 }
 
-void measuring::on_offsetNum_valueChanged(int value)
+void measuring::readSettings()
 {
-    result_line.clear();
-
-    double L = std::sqrt((A.x-B.x)*(A.x-B.x)+(A.y-B.y)*(A.y-B.y));
-
-    double offsetPixels = ui->offsetVal->value();
-    double re_offsetPixels;
-
-    int valT=value;
-
-    cv::Point startP,endP;
-
-    offsetPix = pointPix;
-    QPainter *paint = new QPainter(&offsetPix);
-
-    QLine offsetLine;
-
-    for(int n = 0 ; n<value*2+1 ; n++){// Create N line
-
-        re_offsetPixels = offsetPixels*valT;
-        startP.x=(A.x + re_offsetPixels * (B.y-A.y) / L);
-        startP.y=(A.y + re_offsetPixels * (A.x-B.x) / L);
-        endP.x=(B.x + re_offsetPixels * (B.y-A.y) / L);
-        endP.y=(B.y + re_offsetPixels * (A.x-B.x) / L);
-        if(valT!=0){    //protect Origin Line
-            offsetLine.setLine(startP.x,startP.y,endP.x,endP.y);
-            paint->setPen(QColor(255,0,255,255));
-            paint->drawLine(offsetLine);
-        }
-
-        cv::LineIterator it(image, startP, endP, 8 ,false);//'true' is left to right ,not order
-        std::vector<cv::Point> re_linePoints(it.count);
-        for(int i = 0; i < it.count; i++, ++it)
-        {
-            re_linePoints.at(i) = it.pos();
-        }
-
-        //Gaussian Smooth
-
-        for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 ){
-            cv::GaussianBlur(image,blur_img,cv::Size(i,i),0,0);
-        }
-
-        std::vector<double> axisX;
-        std::vector<double> axisY;
-
-        for(unsigned int i =0;i<re_linePoints.size();i++){
-            axisX.push_back(i);
-            axisY.push_back(blur_img.at<uchar>(re_linePoints.at(i)));
-        }
-
-        std::vector<cv::Point3i> ffPoints = ffSlope(axisX,axisY,ui->amplitudeSlider->value()); //ffSlope.x is *INDEX* for linePoints(from user)  ,ffSlope.y is PixColor
-
-        std::vector<cv::Point3i> points_perOffset(ffPoints.size());
-
-        for(unsigned int i=0 ;i<ffPoints.size() ;i++){
-            points_perOffset.at(i).x= re_linePoints.at(ffPoints.at(i).x).x;
-            points_perOffset.at(i).y= re_linePoints.at(ffPoints.at(i).x).y;
-            points_perOffset.at(i).z= ffPoints.at(i).z;
-            if(valT!=0){
-                QLine mLine;
-                paint->setPen(QColor(100,100,100,255));
-                mLine.setLine(re_linePoints.at(ffPoints.at(i).x).x-4,
-                              re_linePoints.at(ffPoints.at(i).x).y-4,
-                              re_linePoints.at(ffPoints.at(i).x).x+4,
-                              re_linePoints.at(ffPoints.at(i).x).y+4);
-                paint->drawLine(mLine);
-                mLine.setLine(re_linePoints.at(ffPoints.at(i).x).x+4,
-                              re_linePoints.at(ffPoints.at(i).x).y-4,
-                              re_linePoints.at(ffPoints.at(i).x).x-4,
-                              re_linePoints.at(ffPoints.at(i).x).y+4);
-                paint->drawLine(mLine);
-            }
-        }
-        //
-        result_line.push_back(points_perOffset);
-        valT--;
-
-    }
-    delete paint;
-    ui->imgShow->setPixmap(offsetPix);
-    ui->imgShow->setAlignment(Qt::AlignCenter);
+    //the rest of params is set by the slot that changed it
+    params.backend = (ui->smoothBackend->currentIndex() == 1) ? BlurCache::Recursive : BlurCache::Gaussian;
+    params.roiSmooth = ui->roiSmooth->isChecked();
+    params.profileStage = (ui->smoothStage->currentIndex() == 1);
+    params.width = ui->profileWidth->value();
+    params.stripMedian = (ui->stripReduce->currentIndex() == 1);
+    params.amplitude = ui->amplitudeSlider->value();
+    params.bitDepth = ui->bitDepth->currentIndex() ? 8 + 2*ui->bitDepth->currentIndex() : 0;   //10, 12 or 14
+    params.analytic = (ui->edgeMode->currentIndex() == 1);
+    params.sampling = (MeasureParams::Sampling)ui->lineSampling->currentIndex();
 }
 
-void measuring::on_offsetVal_valueChanged(int value)
+void measuring::submitMeasure()
 {
-    ui->offsetNum->setValue(0);
+    readSettings();
+    engine.submit(params);
 }
 
-void measuring::on_resultLine_clicked()
+void measuring::showResult(const MeasureResult &result)
 {
-    qDebug()<<result_line.size();
-
-    for(int i = 0; i< result_line.size(); i++){
-        qDebug("result_lin[%d] = %d",i,result_line.at(i).size());
-    }
+    MEASURE_INFO("measure jobs: %d processed, %d dropped", engine.processed(), engine.dropped());
 
-    for(int i = 0; i< result_line.size(); i++){
-        for(int j = 0; j< result_line.at(i).size(); j++)
-            qDebug("result_lin[%d][%d] : x=%d y=%d z=%d",i,j,result_line.at(i).at(j).x,result_line.at(i).at(j).y,result_line.at(i).at(j).z);
+    if(result.hasAccuracy){
+        const BlurAccuracy &acc = result.accuracy;
+        MEASURE_INFO("recursive vs GaussianBlur, kernel %d (sigma %.2f): max %.0f, mean %.3f, rms %.3f, >1 level %.2f%%",
+               acc.kernel, acc.sigma, acc.maxAbsDiff, acc.meanAbsDiff, acc.rmsDiff, acc.offByMoreThanOne*100);
+        ui->smooth_accuracy->setText(QString("max %1, mean %2").arg(acc.maxAbsDiff).arg(acc.meanAbsDiff,0,'f',2));
     }
 
-    QPixmap resultPix = offsetPix;
-    QPainter *paint = new QPainter(&resultPix);
-    QLine outputLine;
-
-    paint->setPen(QPen(QColor(50,100,200,255),5));
-
-    int slopeType=2; // 1 = up slope, 2 = down slope
+    if(result.params.stage == MeasureParams::ImageOnly)
+        return;
 
-    std::vector<cv::Point> interest_line; //Just one line interested
-    cv::Vec4i re_interest_line;             //Point(x,y) use vec4:(vx, vy, x0, y0) , Point(x,y,z) use vec6:(vx, vy, vz, x0, y0, z0)
-    cv::Point tmp;
-
-    if(result_line.size() >= 3 ){
-        for(int i=0 ; i<result_line.size() ; i++){
-            if(result_line.at(i).size() && result_line.at(i).at(result_line.at(i).size()-1).z == slopeType){ //each offset line select only last point
-                tmp.x=result_line.at(i).at(result_line.at(i).size()-1).x;
-                tmp.y=result_line.at(i).at(result_line.at(i).size()-1).y;
-                interest_line.push_back(tmp);
-            }
-        }
-
-        if(interest_line.size()>1){ //more than 1 point to create line
-            cv::fitLine(interest_line,re_interest_line,cv::DIST_L2, 0, 0.01, 0.01);
-
-            if(re_interest_line[0]){    //re_interest_line[0] == 1 ; it is vertical line
-                unsigned int changeX = (interest_line.at(0).x-interest_line.at(interest_line.size()-1).x)/2;
-                outputLine.setLine(re_interest_line[2]+changeX,
-                        re_interest_line[3],
-                        re_interest_line[2]-changeX,
-                        re_interest_line[3]);
-            }
-            else if(re_interest_line[1]){    //re_interest_line[1] == 1 ; it is horizental line
-                unsigned int changeY = (interest_line.at(0).y-interest_line.at(interest_line.size()-1).y)/2;
-                outputLine.setLine(re_interest_line[2],
-                        re_interest_line[3]+changeY,
-                        re_interest_line[2],
-                        re_interest_line[3]-changeY);
-            }
-            //qDebug("A(%d,%d) B(%d,%d)",interest_line.at(0).x,interest_line.at(0).y,interest_line.at(interest_line.size()-1).x,interest_line.at(interest_line.size()-1).y);
-            //qDebug()<<re_interest_line[2]<<re_interest_line[3]<<" "<<re_interest_line[2]+(re_interest_line[0]*10)<<re_interest_line[3]+(re_interest_line[1]*10);
-            paint->drawLine(outputLine);
-        }
+    std::vector<double> axisX(result.profile.size());
+    for(unsigned int i =0;i<axisX.size();i++){
+        axisX[i] = i;                                           // point index
     }
+    ui->customPlot->graph(0)->setData(QVector<double>::fromStdVector(axisX),QVector<double>::fromStdVector(result.profile));
+    ui->customPlot->xAxis->setRange(0,(int)result.profile.size()-1);
 
-    delete paint;
-    ui->imgShow->setPixmap(resultPix);
-    ui->imgShow->setAlignment(Qt::AlignCenter);
-}
-
-void measuring::findPeak(std::vector<double> &smoothY,std::vector<double> &outputX,std::vector<double> &outputY,int distanceAmpi){
-    //qDebug() << "Gooooooooooooooooooooooood";
-    std::vector<float> dataY(smoothY.size());
-
-    for(int i =0;i<smoothY.size();i++){
-        dataY[i]=smoothY[i];
+    if(result.params.stage == MeasureParams::Profile){
+        ui->customPlot->graph(1)->setData(QVector<double>(),QVector<double>());
+        ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+        return;
     }
 
-    outputX.clear();
-    outputY.clear();
-
-    p1d::Persistence1D p;
-    p.RunPersistence(dataY);
+    ui->customPlot->graph(1)->setData(QVector<double>::fromStdVector(result.peakX),QVector<double>::fromStdVector(result.peakY));
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);   //graph 0 and 1 go out in one replot
 
-    std::vector< p1d::TPairedExtrema > Extrema;
-    p.GetPairedExtrema(Extrema, distanceAmpi);
+    QVector<QPointF> edges((int)result.edges.size());
+    for(unsigned int i=0 ;i<result.edges.size() ;i++)
+        edges[i] = QPointF(result.edges.at(i).x,result.edges.at(i).y);
+    ui->imgShow->setEdges(edges);
 
-    if(Extrema.size())
-        for(std::vector< p1d::TPairedExtrema >::iterator it2 = Extrema.begin(); it2 != Extrema.end(); it2++){
-            outputX.push_back((*it2).MaxIndex);
-            outputX.push_back((*it2).MinIndex);
-        }
-
-    if(outputX.size()<1){
-        int dataMaximum=0;
-        int GetGlobalMaximum;
-        for(int i =0;i<dataY.size();i++)
-        {
-            if(dataY[i]>dataMaximum){
-                dataMaximum = dataY[i];
-                GetGlobalMaximum = i;
-            }
-        }
-        if(dataMaximum-p.GetGlobalMinimumValue() > distanceAmpi)
-            outputX.push_back(GetGlobalMaximum);
-    }
-    outputX.push_back(p.GetGlobalMinimumIndex());
-
-    std::sort(outputX.begin(),outputX.end());
-
-    for(int i=0 ;i<outputX.size() ;i++){
-        outputY.push_back(dataY[outputX[i]]);
-        //axisY.push_back(dataY[(*it2).MinIndex]);
-    }
-    //axisY.push_back(dataY[p.GetGlobalMinimumIndex()]);
+    result_line.clear();
+    showOffsetLines(result);    //no lines clears the old ones
+    ui->exportResult->setEnabled(!result_line.empty());
 }
 
-std::vector<double> measuring::linspace(double a, double b, int n) {
-    std::vector<double> array;
-    double step = (b-a) / (n-1);
-
-    while(a <= b) {
-        array.push_back(a);
-        a += step;           // could recode to better handle rounding errors
-    }
-    return array;
+void measuring::on_offsetNum_valueChanged(int value)
+{
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
+
+    params.stage = MeasureParams::Edges;
+    params.offsets = MeasureParams::ParallelLines;
+    params.offsetNum = value;
+    params.offsetVal = ui->offsetVal->value();
+    submitMeasure();
 }
 
-std::vector<cv::Point3i> measuring::ffSlope(std::vector<double> smoothX,std::vector<double> smoothY,int lengthAmpi){
-
-    std::vector<double> peakX , peakY;
-    findPeak(smoothY,peakX,peakY,lengthAmpi);
-    //qDebug() <<"peakX"<< peakX;
-    //qDebug() <<"peakY"<< peakY;
-
-    std::vector<cv::Point3i> ffPoints(peakX.size()-1);
-
-    for(int t=0 ; t<peakX.size()-1 ; t++){
-        std::vector<double> axisX, axisY;
-        for(int i =0 ;i <= peakX[t+1]-peakX[t];i++){
-            axisX.push_back(peakX[t]+i);
-            axisY.push_back(smoothY[peakX[t]+i]);
-        }
-        //qDebug() <<"axisX"<< axisX.size();
-        //qDebug() <<"axisy"<< axisY.size();
-
-        std::vector<double> splitX = linspace(axisX[0],axisX[axisX.size()-1],axisX.size()*10);
-        //qDebug() <<"splitX"<< splitX;
-        tk::spline s;
-        s.set_points(axisX,axisY);
-
-        axisX.clear();
-        axisY.clear();
-        for(int i =0 ;i<splitX.size();i++){
-            axisX.push_back(splitX[i]);
-            axisY.push_back(s(splitX[i]));
-            qDebug() << axisX[i]<<axisY[i];
-        }
-
-        double slope = 0.0;
-        double ffPoint = 0.0;
-        if(peakY[t+1] > peakY[t]){
-            for(int i =0 ; i < axisX.size()-1 ; i++){
-                slope = (axisY[i+1]-axisY[i]) / (axisX[i+1]-axisX[i]);
-                //qDebug() << slope;
-                if( slope > ffPoint ){
-                    ffPoint=slope;
-                    ffPoints.at(t).x = axisX[i];
-                    ffPoints.at(t).y = axisY[i];
-                }
-            }
-            ffPoints.at(t).z = 1; //increase slope
-        }
-        else if(peakY[t+1] < peakY[t]){
-            for(int i =0 ; i < axisX.size()-1 ; i++){
-                slope = (axisY[i+1]-axisY[i]) / (axisX[i+1]-axisX[i]);
-                //qDebug() << slope;
-                if( slope < ffPoint ){
-                    ffPoint=slope;
-                    ffPoints.at(t).x = axisX[i];
-                    ffPoints.at(t).y = axisY[i];
-                }
-            }
-            ffPoints.at(t).z = 2; //decrease slope
-        }
+void measuring::on_offsetVal_valueChanged(int value)
+{
+    ui->offsetNum->setValue(0);
+}
 
+void measuring::on_resultLine_clicked()
+{
+    MEASURE_DEBUG("result lines: %d", (int)result_line.size());
+    for(unsigned int i = 0; i < result_line.size(); i++){
+        for(unsigned int j = 0; j < result_line[i].size(); j++)
+            MEASURE_DEBUG("result_line[%u][%u] x=%.2f y=%.2f z=%.0f", i, j, result_line[i][j].x, result_line[i][j].y, result_line[i][j].z);
     }
 
-
-    return ffPoints;
+    cv::Point p1,p2;
+    if(fitEdgeLine(result_line,slopeType,p1,p2))
+        ui->imgShow->setFitLine(QLineF(p1.x,p1.y,p2.x,p2.y));
+    else
+        ui->imgShow->clearFit();
 }
 
 void measuring::on_line_operation_toggled(bool checked)
 {
     operation = "linear";
-    ui->imgShow->setPixmap(mPix);
+    ui->imgShow->clearOverlays();
     ui->circle_operation->setChecked(false);
     ui->circle_setting->setEnabled(false);
     ui->line_setting->setEnabled(true);
@@ -841,7 +473,7 @@ void measuring::on_line_operation_toggled(bool checked)
 void measuring::on_circle_operation_toggled(bool checked)
 {
     operation = "circle";
-    ui->imgShow->setPixmap(mPix);
+    ui->imgShow->clearOverlays();
     ui->line_operation->setChecked(false);
     ui->circle_setting->setEnabled(true);
     ui->line_setting->setEnabled(false);
@@ -851,168 +483,268 @@ void measuring::on_circle_operation_toggled(bool checked)
 
 void measuring::on_circle_offsetDeg_valueChanged(int value)
 {
-    if(360%value)
-        ui->circle_offsetNum->setMaximum(360/value);
+    //the slider counts tenths of a degree, up to 3600 rays around the circle
+    ui->circle_offset_radL->setText(QString::number(value/10.0, 'f', 1));
+    if(3600%value)
+        ui->circle_offsetNum->setMaximum(3600/value);
     else
-        ui->circle_offsetNum->setMaximum((360/value)-1);
+        ui->circle_offsetNum->setMaximum((3600/value)-1);
 }
 
 void measuring::on_circle_offsetNum_valueChanged(int value)
 {
-    result_line.clear();
-    offsetPix=pointPix;
-
-    // qDebug() << value;
-    cv::Point pointOnCircle;
-    int re_value = value; //for[ 360 % (degree from user) ] = 0 ,that mean the last offset line same as Origin line
-
-    int radius = std::sqrt((B.x-A.x)*(B.x-A.x) + (B.y-A.y)*(B.y-A.y));
-
-    //reorigin line from X-axis to any AB line
-    int deltaY=B.y-A.y;
-    int deltaX=B.x-A.x;
-    double angleInDegrees = atan2(deltaY,deltaX)*180/PI; //result is 0 to -180 if it's Quadrant 1 to 2 ,180 to 0 if it's Quadrant 3 to 4
-    double angleFromAB;   //set origin line with AB line same as X-axis
-    if(angleInDegrees<0){
-        angleInDegrees = -angleInDegrees;
-        angleFromAB = 2*PI-(angleInDegrees*2*PI/360);
-    } else {
-        angleFromAB = angleInDegrees*2*PI/360;
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
+
+    params.stage = MeasureParams::Edges;
+    params.offsets = MeasureParams::Rays;
+    params.offsetNum = value;
+    params.rayDegree = ui->circle_offsetDeg->value()/10.0;
+    submitMeasure();
+}
+
+void measuring::showOffsetLines(const MeasureResult &result)
+{
+    bool rays = (result.params.offsets == MeasureParams::Rays);
+
+    QVector<OverlayView::OffsetShape> shapes;
+    shapes.reserve((int)result.lines.size());
+    for(unsigned int n = 0 ; n<result.lines.size() ; n++){
+        const OffsetLineResult &line = result.lines.at(n);
+        result_line.push_back(line.edges);
+        if(line.origin)
+            continue;
+
+        OverlayView::OffsetShape shape;
+        shape.line = QLineF(line.start.x,line.start.y,line.end.x,line.end.y);
+        shape.ray = rays;
+        const std::vector<cv::Point3f> &points_perOffset = line.edges;
+        shape.edges.resize((int)points_perOffset.size());
+        for(unsigned int i=0 ;i<points_perOffset.size() ;i++)
+            shape.edges[i] = QPointF(points_perOffset.at(i).x,points_perOffset.at(i).y);
+        shapes.push_back(shape);
+    }
+    ui->imgShow->setOffsets(shapes);
+
+    if(rays){
+        MEASURE_DEBUG("rays: %d", (int)result_line.size());
+        for(unsigned int i = 0; i < result_line.size(); i++){
+            for(unsigned int j = 0; j < result_line[i].size(); j++)
+                MEASURE_DEBUG("ray[%u][%u] x=%.2f y=%.2f z=%.0f", i, j, result_line[i][j].x, result_line[i][j].y, result_line[i][j].z);
+        }
     }
-    //
+}
 
-    double slice = ui->circle_offsetDeg->value()*2*PI/360 ;
+void measuring::on_resultCircle_clicked()
+{
+    cv::Point2f center;
+    float rad;
+    if(fitEdgeCircle(result_line,slopeType,center,rad))
+        ui->imgShow->setFitCircle(QPointF(center.x,center.y),rad);
+    else
+        ui->imgShow->clearFit();
+}
 
+void measuring::on_smoothBackend_currentIndexChanged(int index)
+{
+    if(index != 1)
+        ui->smooth_accuracy->clear();   //the job reports the accuracy when the recursive engine is picked
 
-    QPainter *paint = new QPainter(&offsetPix);
+    if(!source)
+        return;
 
-    for(int n =0;n<re_value+1;n++){ //n=0 is Origin line
+    if(ui->smoothSlider->isEnabled())
+        on_smoothSlider_valueChanged(ui->smoothSlider->value());
+    else
+        submitMeasure();
+}
 
-        double re_angleFromAB = angleFromAB;
-        re_angleFromAB += slice*(n);
-        if(re_angleFromAB>= 2*PI) // > 2PI is > 360 degree
-            re_angleFromAB = re_angleFromAB-(2*PI);
+void measuring::on_smoothStage_currentIndexChanged(int index)
+{
+    ui->roiSmooth->setEnabled(index == 0);
+    ui->smoothBackend->setEnabled(index == 0);
 
-        if(n!=0){
-            pointOnCircle.x = (int)(cos(re_angleFromAB) * radius + A.x);
-            pointOnCircle.y = (int)(sin(re_angleFromAB) * radius + A.y);
+    if(ui->smoothSlider->isEnabled())
+        on_smoothSlider_valueChanged(ui->smoothSlider->value());
+}
 
-            paint->setPen(QColor(255,0,255,255));
-            mLine.setLine(A.x,A.y,pointOnCircle.x,pointOnCircle.y);
-            paint->drawLine(mLine);
-            paint->setBrush(QBrush(Qt::green));
-            paint->drawEllipse(QPoint(pointOnCircle.x,pointOnCircle.y),3,3);
-        }
-        else{
-            pointOnCircle.x = B.x;
-            pointOnCircle.y = B.y;
-        }
+void measuring::on_profileWidth_valueChanged(int value)
+{
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
 
-        cv::LineIterator it(image, A, pointOnCircle, 8 ,false);//'true' is left to right ,not order
-        std::vector<cv::Point> re_linePoints(it.count);
-        for(int i = 0; i < it.count; i++, ++it)
-        {
-            re_linePoints.at(i) = it.pos();
-        }
+    submitMeasure();    //the strip applies in both stages, offset lines included
+}
 
-        //Gaussian Smooth
+void measuring::on_stripReduce_currentIndexChanged(int index)
+{
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
 
-        for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 ){
-            cv::GaussianBlur(image,blur_img,cv::Size(i,i),0,0);
-        }
+    submitMeasure();
+}
 
-        std::vector<double> axisX;
-        std::vector<double> axisY;
+void measuring::on_edgeMode_currentIndexChanged(int index)
+{
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
 
-        for(unsigned int i =0;i<re_linePoints.size();i++){
-            axisX.push_back(i);
-            axisY.push_back(blur_img.at<uchar>(re_linePoints.at(i)));
-        }
-        //
-
-        std::vector<cv::Point3i> ffPoints = ffSlope(axisX,axisY,ui->amplitudeSlider->value()); //ffSlope.x is *INDEX* for linePoints(from user)  ,ffSlope.y is PixColor
-
-        std::vector<cv::Point3i> points_perOffset(ffPoints.size());
-
-        for(unsigned int i=0 ;i<ffPoints.size() ;i++){
-            points_perOffset.at(i).x= re_linePoints.at(ffPoints.at(i).x).x;
-            points_perOffset.at(i).y= re_linePoints.at(ffPoints.at(i).x).y;
-            points_perOffset.at(i).z= ffPoints.at(i).z;
-
-            if(n!=0){
-                QLine mLine;
-                paint->setPen(QColor(100,100,100,255));
-                mLine.setLine(re_linePoints.at(ffPoints.at(i).x).x-4,
-                              re_linePoints.at(ffPoints.at(i).x).y-4,
-                              re_linePoints.at(ffPoints.at(i).x).x+4,
-                              re_linePoints.at(ffPoints.at(i).x).y+4);
-                paint->drawLine(mLine);
-                mLine.setLine(re_linePoints.at(ffPoints.at(i).x).x+4,
-                              re_linePoints.at(ffPoints.at(i).x).y-4,
-                              re_linePoints.at(ffPoints.at(i).x).x-4,
-                              re_linePoints.at(ffPoints.at(i).x).y+4);
-                paint->drawLine(mLine);
-            }
+    params.stage = MeasureParams::Edges;
+    submitMeasure();
+}
 
-        }
+void measuring::on_lineSampling_currentIndexChanged(int index)
+{
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
 
-        result_line.push_back(points_perOffset);
+    submitMeasure();    //every profile is sampled again, the offset lines included
+}
 
+void measuring::on_bitDepth_currentIndexChanged(int index)
+{
+    readSettings();
+    ui->customPlot->yAxis->setRange(0,plotTop());
+    ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
 
-    }
+    if(params.stage == MeasureParams::ImageOnly)
+        return;
 
-    delete paint;
+    //the threshold is in grey levels of the new range
+    params.stage = MeasureParams::Edges;
+    submitMeasure();
+}
 
-    ui->imgShow->setPixmap(offsetPix);
-    ui->imgShow->setAlignment(Qt::AlignCenter);
+void measuring::on_saveRecipe_clicked()
+{
+    QString path = QFileDialog::getSaveFileName(this,tr("Save Recipe"),QString(),tr("Recipes (*.yml *.yaml *.xml *.json)"));
+    if(path.isEmpty())
+        return;
+
+    readSettings();
+    MeasureRecipe recipe;
+    recipe.params = params;
+    recipe.slopeType = slopeType;
+
+    std::string error;
+    if(!saveRecipe(path.toStdString(),recipe,&error))
+        QMessageBox::warning(this,tr("Save Recipe"),QString::fromStdString(error));
+}
 
+void measuring::on_loadRecipe_clicked()
+{
+    QString path = QFileDialog::getOpenFileName(this,tr("Load Recipe"),QString(),tr("Recipes (*.yml *.yaml *.xml *.json)"));
+    if(path.isEmpty())
+        return;
 
-    qDebug()<<"Have line ="<<result_line.size();
-    for(int i =0;i<result_line.size();i++){
-        for(int j =0;j<result_line.at(i).size();j++){
-            qDebug("[%d][%d]  x = %d , y = %d , z = %d",i,j,result_line.at(i).at(j).x,result_line.at(i).at(j).y,result_line.at(i).at(j).z);
-        }
+    MeasureRecipe recipe;
+    std::string error;
+    if(!loadRecipe(path.toStdString(),recipe,&error)){
+        QMessageBox::warning(this,tr("Load Recipe"),QString::fromStdString(error));
+        return;
     }
-
-
-
+    applyRecipe(recipe);
 }
 
-void measuring::on_resultCircle_clicked()
+void measuring::applyRecipe(const MeasureRecipe &recipe)
 {
-    /* QPixmap resultPix = offsetPix;
-    QPainter *paint = new QPainter(&resultPix);
-    paint->setPen(QPen(QColor(50,100,200,255),5));
-
-    QLine outputCircle;
-
+    const MeasureParams &p = recipe.params;
+    slopeType = recipe.slopeType;
+    bool rays = (p.offsets == MeasureParams::Rays);
 
+    //widgets are set with their signals blocked, so none of the slider slots
+    //runs; the whole measurement is submitted once at the end
+    {
+        const QSignalBlocker b1(ui->smoothSlider), b2(ui->amplitudeSlider), b3(ui->smoothBackend),
+                b4(ui->roiSmooth), b5(ui->smoothStage), b6(ui->profileWidth), b15(ui->stripReduce), b7(ui->edgeMode), b14(ui->lineSampling), b16(ui->bitDepth),
+                b8(ui->offsetVal), b9(ui->offsetNum), b10(ui->circle_offsetDeg), b11(ui->circle_offsetNum),
+                b12(ui->line_operation), b13(ui->circle_operation);
+
+        ui->smoothSlider->setValue(p.kernel+2);
+        ui->amplitudeSlider->setValue(p.amplitude);
+        ui->smoothBackend->setCurrentIndex(p.backend == BlurCache::Recursive ? 1 : 0);
+        ui->roiSmooth->setChecked(p.roiSmooth);
+        ui->smoothStage->setCurrentIndex(p.profileStage ? 1 : 0);
+        ui->profileWidth->setValue(p.width);
+        ui->stripReduce->setCurrentIndex(p.stripMedian ? 1 : 0);
+        ui->edgeMode->setCurrentIndex(p.analytic ? 1 : 0);
+        ui->lineSampling->setCurrentIndex(p.sampling);
+        ui->bitDepth->setCurrentIndex((p.bitDepth >= 10 && p.bitDepth <= 14 && p.bitDepth%2 == 0) ? (p.bitDepth-8)/2 : 0);
+        ui->offsetVal->setValue(p.offsetVal);
+        ui->offsetNum->setValue(rays ? 0 : p.offsetNum);
+        if(rays){
+            ui->circle_offsetDeg->setValue(cvRound(p.rayDegree*10));
+            on_circle_offsetDeg_valueChanged(ui->circle_offsetDeg->value());
+            ui->circle_offsetNum->setValue(p.offsetNum);
+        }
+        ui->line_operation->setChecked(!rays);
+        ui->circle_operation->setChecked(rays);
+    }
+
+    //what the blocked signals would have updated
+    ui->smooth_value->setNum(ui->smoothSlider->value());
+    ui->amplitude_value->setNum(ui->amplitudeSlider->value());
+    ui->offset_disL->setNum(ui->offsetVal->value());
+    ui->offset_numL->setNum(ui->offsetNum->value());
+    ui->circle_offset_numL->setNum(ui->circle_offsetNum->value());
+    ui->roiSmooth->setEnabled(!p.profileStage);
+    ui->smoothBackend->setEnabled(!p.profileStage);
+
+    operation = rays ? "circle" : "linear";
+    ui->circle_setting->setEnabled(rays);
+    ui->line_setting->setEnabled(!rays);
+
+    //AB line, marked like a line drawn with the mouse
+    pre_A = A = p.a;
+    pre_B = B = p.b;
+    ui->x1->setText(QString::number(A.x,'f',2));
+    ui->y1->setText(QString::number(A.y,'f',2));
+    ui->x2->setText(QString::number(B.x,'f',2));
+    ui->y2->setText(QString::number(B.y,'f',2));
+
+    ui->imgShow->setLine(QLineF(A.x,A.y,B.x,B.y));
 
-        delete paint;
-            ui->imgShow->setPixmap(resultPix);
-            ui->imgShow->setAlignment(Qt::AlignCenter);*/
-    //init
-    cv::Mat circle_output = QPixmapToCvMat(offsetPix);
-    std::vector<cv::Point> point;
+    /// UI:control ///
+    ui->showGraph->setEnabled(true);
+    ui->saveRecipe->setEnabled(true);
+    ui->smoothSlider->setEnabled(true);
+    ui->amplitudeSlider->setEnabled(true);
+    ui->offsetVal->setEnabled(true);
+    ui->offsetNum->setEnabled(true);
+    //////////////////
 
-    int slopeType=2;
+    //submitted as stored, the widgets above may have clamped some values
+    params = p;
+    setupGraph();
+    params.stage = MeasureParams::Edges;
+    engine.submit(params);
+}
 
-    if(result_line.size() >= 3 ){
-        for(int i=0 ; i<result_line.size() ; i++){
-            if(result_line.at(i).size() && result_line.at(i).at(result_line.at(i).size()-1).z == slopeType){ //each offset line select only last point
-                point.push_back(cv::Point(result_line.at(i).at(result_line.at(i).size()-1).x,result_line.at(i).at(result_line.at(i).size()-1).y));
-            }
-        }
+void measuring::on_exportResult_clicked()
+{
+    //appends, so one file can collect the results of several images
+    QString path = QFileDialog::getSaveFileName(this,tr("Export Results"),QString(),
+                                                tr("CSV (*.csv);;Columnar (*.mcol)"),0,QFileDialog::DontConfirmOverwrite);
+    if(path.isEmpty())
+        return;
+
+    std::string error;
+    cv::Ptr<ResultSink> sink = openResultSink(path.toStdString(),&error);
+    if(!sink){
+        QMessageBox::warning(this,tr("Export Results"),QString::fromStdString(error));
+        return;
+    }
+
+    //the offset lines or rays the fit uses; the AB line's own edges are
+    //not part of a record, see resultsink.h
+    MeasureRecord record;
+    record.image = imagePath.toStdString();
+    record.lines = result_line;
+    if(operation == "circle")
+        record.circleFitted = fitEdgeCircle(result_line,slopeType,record.center,record.radius);
+    else
+        record.lineFitted = fitEdgeLine(result_line,slopeType,record.p1,record.p2);
 
-        if(point.size()>1){ //more than 1 point to create line
-            cv::Point2f center;
-            float rad;
-            //function
-            cv::minEnclosingCircle(point,center,rad);
-            cv::circle(circle_output,center,rad,cv::Scalar(255,80,40),2,cv::LINE_8);
-            QPixmap resultPix = cvMatToQPixmap(circle_output);
-            ui->imgShow->setPixmap(resultPix);
-            ui->imgShow->setAlignment(Qt::AlignCenter);
-        }
-    }
+    if(!sink->write(record) || !sink->flush())
+        QMessageBox::warning(this,tr("Export Results"),tr("cannot write to %1").arg(path));
 }
@@ -2,6 +2,9 @@
 #define MEASURING_H
 
 #include "qcustomplot.h"
+#include "measureengine.h"
+#include "measurerecipe.h"
+#include "imageloader.h"
 
 #include <QGuiApplication>
 #include <QDialog>
@@ -41,21 +44,38 @@ public:
 private:
     Ui::measuring *ui;
 
-    cv::Mat image,blur_img; //blur_img : use in Guassian Smooth
-    QLine mLine;
-    QPixmap mPix,linePix,offsetPix,pointPix,tmp_pix;
+    cv::Ptr<ImageSource> source;    //the image, decoded or memory mapped, null while one loads
+    cv::Point2f pre_A,pre_B,A,B,line_begin;    //line being drawn, and the AB line of the measurement, sub-pixel
+    std::vector< std::vector<cv::Point3f> > result_line;    //edges of each offset line or ray of the last result
+    MeasureEngine engine;   //blur, persistence and edge search, off the GUI thread
+    ImageLoader loader;     //decodes off the GUI thread, prefetches the next image of the folder
+    MeasureParams::Stage reloadStage;   //stage the image being loaded is measured at, ImageOnly for a fresh one
+    MeasureParams params;   //state the next job is submitted with
+    QString imagePath;      //file the image was read from, written with exported results
+    QString rawFormat;      //WIDTHxHEIGHT[x16][+HEADER] of .raw frames, asked for when one is opened
+    int slopeType;          //edge type fitted by resultLine/resultCircle, 1 = up slope, 2 = down slope
+    QLineF mLine;           //line being dragged, drawn by the view's overlay
 
 protected:
     void mousePressEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
 
-    std::vector<double> linspace(double a, double b, int n) ;
-    std::vector<cv::Point3i> ffSlope(std::vector<double> smoothX,std::vector<double> smoothY,int lengthAmpi);
-    void findPeak(std::vector<double> &smoothY,std::vector<double> &outputX,std::vector<double> &outputY,int distanceAmpi);
+    void setupGraph();
+    double plotTop() const;     //white of the image's depth and bits, the profile plot's y range
+    void readSettings();
+    void submitMeasure();
+    void showOffsetLines(const MeasureResult &result);
+    void applyRecipe(const MeasureRecipe &recipe);
+    void startLoading(const QString &path, bool keepMeasurement);
 
 private slots:
     void on_showImg_clicked();
+    void on_nextImage_clicked();
+    void showPreview(const QString &path, const ImageLoader::Display &preview, int factor);
+    void imageLoaded(const QString &path, const cv::Ptr<ImageSource> &loaded, const ImageLoader::Display &display);
+    void showOverview(const QString &path, const ImageLoader::Display &overview, int factor);
+    void imageLoadFailed(const QString &path);
     void on_showGraph_clicked();
     void on_smoothSlider_valueChanged(int value);
     void on_amplitudeSlider_valueChanged(int value);
@@ -67,6 +87,17 @@ private slots:
     void on_circle_offsetDeg_valueChanged(int value);
     void on_circle_offsetNum_valueChanged(int value);
     void on_resultCircle_clicked();
+    void on_smoothBackend_currentIndexChanged(int index);
+    void on_smoothStage_currentIndexChanged(int index);
+    void on_profileWidth_valueChanged(int value);
+    void on_stripReduce_currentIndexChanged(int index);
+    void on_edgeMode_currentIndexChanged(int index);
+    void on_lineSampling_currentIndexChanged(int index);
+    void on_bitDepth_currentIndexChanged(int index);
+    void on_saveRecipe_clicked();
+    void on_loadRecipe_clicked();
+    void on_exportResult_clicked();
+    void showResult(const MeasureResult &result);
 };
 
 
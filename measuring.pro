@@ -4,12 +4,13 @@
 #
 #-------------------------------------------------
 
-QT       += core gui printsupport
+QT       += core gui printsupport concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = measuring
 TEMPLATE = app
+CONFIG += c++11
 
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which has been marked as deprecated (the exact warnings
@@ -27,22 +28,23 @@ SOURCES += \
         main.cpp \
         measuring.cpp \
     qcustomplot.cpp \
-    persistence1d_driver.cpp
+    persistence1d_driver.cpp \
+    measureengine.cpp \
+    overlayview.cpp \
+    imagepyramid.cpp \
+    imageloader.cpp \
+    displaywindow.cpp
 
 HEADERS += \
         measuring.h \
     qcustomplot.h \
-    persistence1d.hpp \
-    spline.h
+    measureengine.h \
+    overlayview.h \
+    imagepyramid.h \
+    imageloader.h \
+    displaywindow.h
 
 FORMS += \
         measuring.ui
 
-INCLUDEPATH += E:\openCV\opencv\opencv_build\install\include
-
-LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_core341.dll
-LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_highgui341.dll
-LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_imgcodecs341.dll
-LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_imgproc341.dll
-LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_features2d341.dll
-LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_calib3d341.dll
+include(measurecore.pri)
@@ -0,0 +1,10 @@
+# OpenCV 3.4.1 build shared by every target of the project
+
+INCLUDEPATH += E:\openCV\opencv\opencv_build\install\include
+
+LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_core341.dll
+LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_highgui341.dll
+LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_imgcodecs341.dll
+LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_imgproc341.dll
+LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_features2d341.dll
+LIBS += E:\openCV\opencv\opencv_build\bin\libopencv_calib3d341.dll
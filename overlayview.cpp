@@ -0,0 +1,372 @@
+#include "overlayview.h"
+
+#include <QImage>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const int tileCacheBytes = 64 << 20;    // about 256 tiles of 256 x 256, several screens' worth
+const double minScale = 1.0 / 64, maxScale = 64;
+const int sourceLevel = 255;            // tile key level of the full size tiles of a mapped image
+const double sourceMinScale = 0.5;      // zoomed out further, its tiles would read too many pixels per screen pixel
+
+void drawCross(QPainter &paint, const QPointF &p)
+{
+    paint.drawLine(QLineF(p+QPointF(-4,-4),p+QPointF(4,4)));
+    paint.drawLine(QLineF(p+QPointF(4,-4),p+QPointF(-4,4)));
+}
+
+QRectF lineRect(const QLineF &line)
+{
+    return QRectF(line.p1(), line.p2()).normalized();
+}
+
+quint64 tileKey(int level, int tx, int ty)
+{
+    return ((quint64)level << 48) | ((quint64)ty << 24) | (quint64)tx;
+}
+
+} // namespace
+
+OverlayView::OverlayView(QWidget *parent) :
+    QWidget(parent),
+    m_levelScale(1),
+    m_scale(1),
+    m_panning(false),
+    m_dragging(false),
+    m_hasLine(false),
+    m_fit(NoFit),
+    m_fitRadius(0)
+{
+    m_tiles.setMaxCost(tileCacheBytes);
+}
+
+void OverlayView::setImage(const cv::Ptr<ImageSource> &source, const ImagePyramid &pyramid, const DisplayWindow &window)
+{
+    bool fromPreview = !m_source && !m_pyramid.empty() && m_levelScale > 1;
+    m_tiles.clear();
+    if(!source->decoded().empty()){
+        m_source.release();
+        m_pyramid = pyramid;
+        m_window = window;
+    }
+    else{
+        //nothing is read until tiles are drawn
+        m_source = source;
+        m_pyramid.clear();
+        m_window.reset(source->type());     //until the overview tells the range
+        fromPreview = false;
+    }
+    m_imageSize = source->size();
+    m_levelScale = 1;
+    clearOverlays();
+    if(!fromPreview)
+        fitToWindow();
+}
+
+void OverlayView::setPreview(const ImagePyramid &preview, const DisplayWindow &window, int factor)
+{
+    if(preview.empty())
+        return;
+    m_source.release();
+    m_tiles.clear();
+    m_pyramid = preview;
+    m_window = window;
+    m_levelScale = std::max(factor, 1);
+    m_imageSize = cv::Size(preview.level(0).cols * m_levelScale, preview.level(0).rows * m_levelScale);
+    clearOverlays();
+    fitToWindow();
+}
+
+void OverlayView::setOverview(const ImagePyramid &overview, const DisplayWindow &window, int factor)
+{
+    if(!m_source)
+        return;
+    m_pyramid = overview;
+    m_window = window;
+    if(m_source->type() != CV_8UC1)
+        m_tiles.clear();    //the file's tiles were drawn with the full range window, 8-bit ones stay valid
+    m_levelScale = std::max(factor, 1);
+    update();
+}
+
+void OverlayView::fitToWindow()
+{
+    if(!hasImage())
+        return;
+    //whole image in view, small images stay 1:1
+    m_scale = std::min(1.0, std::min((double)width() / m_imageSize.width, (double)height() / m_imageSize.height));
+    m_offset = QPointF((width() - m_imageSize.width*m_scale) / 2, (height() - m_imageSize.height*m_scale) / 2);
+    update();
+}
+
+bool OverlayView::toImage(const QPoint &widgetPos, QPointF &imagePos) const
+{
+    if(!hasImage())
+        return false;
+    QPointF p = (QPointF(widgetPos) - m_offset) / m_scale - QPointF(0.5, 0.5);
+    if(p.x() < -0.5 || p.y() < -0.5 || p.x() > m_imageSize.width-0.5 || p.y() > m_imageSize.height-0.5)
+        return false;
+    imagePos = p;
+    return true;
+}
+
+QPointF OverlayView::toWidget(const QPointF &imagePos) const
+{
+    return (imagePos + QPointF(0.5, 0.5)) * m_scale + m_offset;
+}
+
+QLineF OverlayView::toWidget(const QLineF &line) const
+{
+    return QLineF(toWidget(line.p1()), toWidget(line.p2()));
+}
+
+void OverlayView::updateImageRect(const QRectF &rect)
+{
+    //pen width and the end marks spill a few pixels over the shape
+    QRectF r = QRectF(toWidget(rect.topLeft()), toWidget(rect.bottomRight())).normalized();
+    update(r.toAlignedRect().adjusted(-6,-6,6,6));
+}
+
+void OverlayView::setRubberBand(const QLineF &line)
+{
+    QRectF dirty = lineRect(line);
+    if(m_dragging)
+        dirty |= lineRect(m_rubberBand);
+    m_rubberBand = line;
+    m_dragging = true;
+    updateImageRect(dirty);
+}
+
+void OverlayView::clearRubberBand()
+{
+    if(!m_dragging)
+        return;
+    m_dragging = false;
+    updateImageRect(lineRect(m_rubberBand));
+}
+
+void OverlayView::setLine(const QLineF &line)
+{
+    clearOverlays();
+    m_line = line;
+    m_hasLine = true;
+}
+
+void OverlayView::setEdges(const QVector<QPointF> &edges)
+{
+    m_edges = edges;
+    update();
+}
+
+void OverlayView::setOffsets(const QVector<OffsetShape> &offsets)
+{
+    m_offsets = offsets;
+    m_fit = NoFit;
+    update();
+}
+
+void OverlayView::setFitLine(const QLineF &line)
+{
+    m_fit = FitLine;
+    m_fitLine = line;
+    update();
+}
+
+void OverlayView::setFitCircle(const QPointF &center, double radius)
+{
+    m_fit = FitCircle;
+    m_fitCenter = center;
+    m_fitRadius = radius;
+    update();
+}
+
+void OverlayView::clearFit()
+{
+    m_fit = NoFit;
+    update();
+}
+
+void OverlayView::clearOverlays()
+{
+    m_dragging = false;
+    m_hasLine = false;
+    m_edges.clear();
+    m_offsets.clear();
+    m_fit = NoFit;
+    update();
+}
+
+QPixmap OverlayView::tilePixmap(int level, int tx, int ty)
+{
+    quint64 key = tileKey(level, tx, ty);
+    if(QPixmap *cached = m_tiles.object(key))
+        return *cached;
+
+    cv::Mat tile;
+    if(level == sourceLevel){
+        int size = m_pyramid.tileSize();
+        tile = m_source->read(cv::Rect(tx*size, ty*size, size, size) & cv::Rect(0, 0, m_imageSize.width, m_imageSize.height));
+    }
+    else{
+        tile = m_pyramid.tile(level, tx, ty);
+    }
+    tile = m_window.apply(tile);
+    QImage image(tile.data, tile.cols, tile.rows, (int)tile.step, QImage::Format_Grayscale8);
+    QPixmap pixmap = QPixmap::fromImage(image);     //copies the tile, the view into the level is not kept
+    m_tiles.insert(key, new QPixmap(pixmap), pixmap.width() * pixmap.height() * 4);
+    return pixmap;
+}
+
+void OverlayView::paintTiles(QPainter &paint, const QRect &dirty)
+{
+    //a mapped image zoomed in past its overview is drawn from the file's
+    //full size tiles
+    bool fromSource = m_source && (m_pyramid.empty() || m_levelScale > 1) && m_scale >= sourceMinScale;
+    if(!fromSource && m_pyramid.empty())
+        return;     //zoomed out, and the overview is still being read
+
+    //image plane area under the dirty rectangle, in pixels of the chosen level
+    int size = m_pyramid.tileSize();
+    int level = fromSource ? sourceLevel : m_pyramid.levelFor(m_scale * m_levelScale);
+    int f = fromSource ? 1 : (1 << level) * m_levelScale;   //image pixels per level pixel
+    double tileSpan = (double)size * f;   //image pixels per tile
+    cv::Size tiles = fromSource ? cv::Size((m_imageSize.width + size-1) / size, (m_imageSize.height + size-1) / size)
+                                : m_pyramid.tiles(level);
+
+    QPointF from = (QPointF(dirty.topLeft()) - m_offset) / m_scale;
+    QPointF to = (QPointF(dirty.bottomRight() + QPoint(1,1)) - m_offset) / m_scale;
+    int tx0 = std::max((int)std::floor(from.x() / tileSpan), 0);
+    int ty0 = std::max((int)std::floor(from.y() / tileSpan), 0);
+    int tx1 = std::min((int)std::floor(to.x() / tileSpan), tiles.width-1);
+    int ty1 = std::min((int)std::floor(to.y() / tileSpan), tiles.height-1);
+
+    //zoomed in the pixels show as squares, sub-pixel placement sees them
+    paint.setRenderHint(QPainter::SmoothPixmapTransform, m_scale < 1);
+    for(int ty = ty0; ty <= ty1; ty++){
+        for(int tx = tx0; tx <= tx1; tx++){
+            QPixmap pixmap = tilePixmap(level, tx, ty);
+            QRectF target(m_offset + QPointF(tx*tileSpan, ty*tileSpan) * m_scale,
+                          QSizeF(pixmap.width(), pixmap.height()) * (f * m_scale));
+            paint.drawPixmap(target, pixmap, QRectF(pixmap.rect()));
+        }
+    }
+}
+
+void OverlayView::paintEvent(QPaintEvent *event)
+{
+    QPainter paint(this);
+    paint.fillRect(event->rect(), palette().dark());
+    if(!hasImage())
+        return;
+    paintTiles(paint, event->rect());
+    paint.setRenderHint(QPainter::SmoothPixmapTransform, false);
+
+    QRectF dirty = QRectF(event->rect()).adjusted(-6,-6,6,6);
+
+    for(int n = 0; n < m_offsets.size(); n++){
+        const OffsetShape &shape = m_offsets.at(n);
+        QLineF line = toWidget(shape.line);
+        paint.setPen(QColor(255,0,255,255));
+        if(dirty.intersects(lineRect(line).adjusted(-1,-1,1,1)))
+            paint.drawLine(line);
+        if(shape.ray){
+            paint.setBrush(QBrush(Qt::green));
+            paint.drawEllipse(line.p2(),3,3);
+            paint.setBrush(Qt::NoBrush);
+        }
+        paint.setPen(QColor(100,100,100,255));
+        for(int i = 0; i < shape.edges.size(); i++){
+            QPointF edge = toWidget(shape.edges.at(i));
+            if(dirty.contains(edge))
+                drawCross(paint, edge);
+        }
+    }
+
+    if(m_hasLine){
+        QLineF line = toWidget(m_line);
+        paint.setPen(QColor(0,255,255,255));
+        paint.drawLine(line);
+        paint.setBrush(QBrush(Qt::red));     //--line header-|
+        paint.drawEllipse(line.p2(),3,3);    //--------------|
+        paint.setBrush(Qt::NoBrush);
+    }
+
+    paint.setPen(QColor(0,0,255,255));
+    for(int i = 0; i < m_edges.size(); i++)    //sub-pixel positions, crosses drawn in floating point
+        drawCross(paint, toWidget(m_edges.at(i)));
+
+    if(m_fit == FitLine){
+        paint.setPen(QPen(QColor(50,100,200,255),5));
+        paint.drawLine(toWidget(m_fitLine));
+    }
+    else if(m_fit == FitCircle){
+        paint.setPen(QPen(QColor(40,80,255,255),2));
+        paint.drawEllipse(toWidget(m_fitCenter), m_fitRadius*m_scale, m_fitRadius*m_scale);
+    }
+
+    if(m_dragging){
+        paint.setPen(QColor(255,34,255,255));
+        paint.drawLine(toWidget(m_rubberBand));
+    }
+}
+
+void OverlayView::zoomAbout(const QPointF &widgetPos, double scale)
+{
+    //the image point under the cursor stays under it
+    scale = std::min(std::max(scale, minScale), maxScale);
+    QPointF plane = (widgetPos - m_offset) / m_scale;
+    m_scale = scale;
+    m_offset = widgetPos - plane * m_scale;
+    update();
+}
+
+void OverlayView::wheelEvent(QWheelEvent *event)
+{
+    if(!hasImage()){
+        event->ignore();
+        return;
+    }
+    double steps = event->angleDelta().y() / 120.0;    //touchpads send fractions of a notch
+    zoomAbout(event->posF(), m_scale * std::pow(1.25, steps));
+    event->accept();
+}
+
+void OverlayView::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::RightButton || event->button() == Qt::MiddleButton){
+        m_panning = true;
+        m_panFrom = event->pos();
+        event->accept();
+        return;
+    }
+    event->ignore();    //the measurement tools, handled by the dialog
+}
+
+void OverlayView::mouseMoveEvent(QMouseEvent *event)
+{
+    if(!m_panning){
+        event->ignore();
+        return;
+    }
+    m_offset += QPointF(event->pos() - m_panFrom);
+    m_panFrom = event->pos();
+    update();
+}
+
+void OverlayView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(m_panning && (event->button() == Qt::RightButton || event->button() == Qt::MiddleButton)){
+        m_panning = false;
+        event->accept();
+        return;
+    }
+    event->ignore();
+}
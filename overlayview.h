@@ -0,0 +1,121 @@
+#ifndef OVERLAYVIEW_H
+#define OVERLAYVIEW_H
+
+#include "displaywindow.h"
+#include "imagepyramid.h"
+#include "imagesource.h"
+
+#include <QCache>
+#include <QLineF>
+#include <QPixmap>
+#include <QPointF>
+#include <QVector>
+#include <QWidget>
+
+#include <opencv2/core/core.hpp>
+
+// The image display: a zoomable, pannable view drawn from 256 pixel tiles
+// of an ImagePyramid, at the level that matches the zoom. Only visible
+// tiles become pixmaps and those stay in an LRU cache with a byte budget,
+// so a 100 MP image costs the screen's worth of tiles, not a full-size
+// pixmap. A memory mapped image has no pyramid of its own: zoomed in, its
+// tiles are read straight from the file; zoomed out, its overview stands in
+// for the pyramid. 16-bit and float images are shown through a grey
+// window fitted to their overview or pyramid, see displaywindow.h.
+//
+// Everything drawn over the image (the line being dragged, the AB line,
+// edge crosses, offset lines or rays, fitted line or circle) is kept as
+// shapes in image coordinates and painted on top in paintEvent. Changing
+// an overlay repaints only the rectangle it covers, so the rubber band
+// follows the mouse at input rate whatever the image size.
+//
+// Image coordinates put integer values at pixel centres, like the
+// samplers. The wheel zooms about the cursor, the right or middle button
+// pans; left button events are ignored and reach the parent, which runs
+// the measurement tools through toImage().
+class OverlayView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit OverlayView(QWidget *parent = 0);
+
+    // The pyramids and their grey windows are built off the GUI thread (see
+    // ImageLoader), the view only takes them over.
+    //
+    // A decoded source (CV_8UC1, CV_16UC1 or CV_32FC1) with the pyramid of
+    // its pixels; clears the overlays. The view is fitted to the image,
+    // unless a preview of it was shown: then zoom and position stay. A
+    // mapped source has no pyramid, it is shown from its tiles until
+    // setOverview() gives the coarse levels.
+    void setImage(const cv::Ptr<ImageSource> &source, const ImagePyramid &pyramid, const DisplayWindow &window);
+    // Reduced image shown until the full one arrives, "factor" image pixels
+    // per preview pixel; coordinates are those of the full image already.
+    void setPreview(const ImagePyramid &preview, const DisplayWindow &window, int factor);
+    void setOverview(const ImagePyramid &overview, const DisplayWindow &window, int factor);
+    bool hasImage() const { return m_imageSize.area() > 0; }
+
+    void fitToWindow();
+    double scale() const { return m_scale; }    // screen pixels per image pixel
+
+    // Sub-pixel image position under a widget position; false outside the image.
+    bool toImage(const QPoint &widgetPos, QPointF &imagePos) const;
+    QPointF toWidget(const QPointF &imagePos) const;
+
+    void setRubberBand(const QLineF &line);
+    void clearRubberBand();
+    void setLine(const QLineF &line);       // the AB line, drops every result drawn for the old one
+
+    struct OffsetShape
+    {
+        QLineF line;
+        bool ray;                           // marked at its end
+        QVector<QPointF> edges;
+    };
+    void setEdges(const QVector<QPointF> &edges);          // on the AB line
+    void setOffsets(const QVector<OffsetShape> &offsets);  // replaces the fit too
+    void setFitLine(const QLineF &line);
+    void setFitCircle(const QPointF &center, double radius);
+    void clearFit();
+    void clearOverlays();
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+
+private:
+    void paintTiles(QPainter &paint, const QRect &dirty);
+    QPixmap tilePixmap(int level, int tx, int ty);
+    void zoomAbout(const QPointF &widgetPos, double scale);
+    void updateImageRect(const QRectF &rect);
+    QLineF toWidget(const QLineF &line) const;
+
+    ImagePyramid m_pyramid;
+    DisplayWindow m_window;                 // applied as tiles become pixmaps
+    cv::Ptr<ImageSource> m_source;          // mapped image, tiles are read from it when zoomed in
+    QCache<quint64, QPixmap> m_tiles;       // cost in bytes
+    cv::Size m_imageSize;                   // full image, the preview's times its factor
+    int m_levelScale;                       // image pixels per pyramid level 0 pixel, > 1 for a preview or overview
+    double m_scale;
+    QPointF m_offset;                       // widget position of the image's top left corner
+    bool m_panning;
+    QPoint m_panFrom;
+
+    bool m_dragging;
+    QLineF m_rubberBand;
+    bool m_hasLine;
+    QLineF m_line;
+    QVector<QPointF> m_edges;
+    QVector<OffsetShape> m_offsets;
+
+    enum Fit { NoFit, FitLine, FitCircle };
+    Fit m_fit;
+    QLineF m_fitLine;
+    QPointF m_fitCenter;
+    double m_fitRadius;
+};
+
+#endif // OVERLAYVIEW_H
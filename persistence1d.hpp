@@ -14,6 +14,7 @@
 #define NO_COLOR -1
 #define RESIZE_FACTOR 20
 #define MATLAB_INDEX_FACTOR 1
+#define COUNTING_SORT_MAX_RANGE 65536
 
 namespace p1d 
 {
@@ -42,6 +43,32 @@ struct TIdxAndData
 };
 
 
+/** Non-owning view of the input data of a run, float, double or 8-bit.
+
+	Behaves like the const parts of std::vector<float> used by the algorithm, so
+	input can be read in place from a caller's buffer. 8-bit and double values are 
+	converted to float as they are read; the branch on the input type is taken the
+	same way for a whole run, so it costs next to nothing next to a copy.
+*/
+struct TDataView
+{
+	TDataView():Floats(0),Doubles(0),Bytes(0),Size(0){}
+
+	float operator[](const size_t i) const 
+	{ 
+		return Floats ? Floats[i] : Doubles ? (float)Doubles[i] : (float)Bytes[i]; 
+	}
+	size_t size() const { return Size; }
+	bool empty() const { return Size == 0; }
+
+	///Exactly one of Floats, Doubles and Bytes is set during a run.
+	const float* Floats;
+	const double* Doubles;
+	const unsigned char* Bytes;
+	size_t Size;
+};
+
+
 /*! Defines a component within the data domain. 
 	A component is created at a local minimum - a vertex whose value is smaller than both of its neighboring 
 	vertices' values.
@@ -127,19 +154,78 @@ public:
 	*/
 	bool RunPersistence(const std::vector<float>& InputData)
 	{	
-		Data = InputData; 
-		Init();
+		return RunPersistence(InputData.empty() ? 0 : &InputData[0], InputData.size());
+	}
 
-		//If a user runs this on an empty vector, then they should not get the results of the previous run.
-		if (Data.empty()) return false;
+	/*!
+		Same as above, from a float buffer. Like every overload it reads the data 
+		in place instead of copying it: the buffer must stay valid and unchanged 
+		until this call returns.
 
-		CreateIndexValueVector();
-		Watershed();
-		SortPairedExtrema();
-#ifdef _DEBUG
-		VerifyAliveComponents();	
-#endif
-		return true;
+		One Persistence1D object can be used as a workspace for many runs in a row: 
+		all internal vectors keep their capacity between runs, so once they have grown
+		to the largest input (or after Reserve), further runs do not allocate.
+
+		@param[in] InputData	Pointer to the first of Count values.
+		@param[in] Count		Number of values.
+	*/
+	bool RunPersistence(const float* InputData, const size_t Count)
+	{
+		Data.Floats = InputData;
+		Data.Doubles = 0;
+		Data.Bytes = 0;
+		Data.Size = Count;
+		return Run();
+	}
+
+	/*!
+		Same as above, for double data such as a sampled or smoothed profile, 
+		read in place: each value is rounded to float as the algorithm reads it, 
+		exactly as a float copy of the buffer would hold it.
+
+		@param[in] InputData	Pointer to the first of Count values.
+		@param[in] Count		Number of values.
+	*/
+	bool RunPersistence(const double* InputData, const size_t Count)
+	{
+		Data.Floats = 0;
+		Data.Doubles = InputData;
+		Data.Bytes = 0;
+		Data.Size = Count;
+		return Run();
+	}
+
+	/*!
+		Same as above, for 8-bit data such as a profile of image pixels, also read 
+		in place: the values are widened as the algorithm reads them.
+
+		@param[in] InputData	Pointer to the first of Count values.
+		@param[in] Count		Number of values.
+	*/
+	bool RunPersistence(const unsigned char* InputData, const size_t Count)
+	{
+		Data.Floats = 0;
+		Data.Doubles = 0;
+		Data.Bytes = InputData;
+		Data.Size = Count;
+		return Run();
+	}
+
+
+	/*!
+		Reserves the internal buffers for inputs of up to MaxSize values, 
+		so that the following runs do not allocate.
+
+		@param[in] MaxSize	Largest number of values that will be passed to RunPersistence.
+	*/
+	void Reserve(const size_t MaxSize)
+	{
+		SortedData.reserve(MaxSize);
+		Colors.reserve(MaxSize);
+		Counts.reserve(std::min(MaxSize * 4 + 256, (size_t)COUNTING_SORT_MAX_RANGE) + 1);
+		//a profile has at most one minimum per two samples
+		Components.reserve(MaxSize / 2 + 1);
+		PairedExtrema.reserve(MaxSize / 2 + 1);
 	}
 
 
@@ -214,7 +300,7 @@ public:
 
 		if (lower_bound == PairedExtrema.end()) return false;
 		
-		pairs = std::vector<TPairedExtrema>(lower_bound, PairedExtrema.end());
+		pairs.assign(lower_bound, PairedExtrema.end());	//keeps the capacity of pairs
 		
 		if (matlabIndexing) //match matlab indices by adding one
 		{
@@ -341,17 +427,23 @@ public:
 
 protected:
 	/*!
-		Contain a copy of the original input data.
+		View of the input data of the current run.
 	*/
-	std::vector<float> Data;
-	
-	
+	TDataView Data;
+
+
 	/*!
 		Contains a copy the value and index pairs of Data, sorted according to the data values.
 	*/
 	std::vector<TIdxAndData> SortedData; 
 
 
+	/*!
+		Bucket offsets used when SortedData is built by counting sort.
+	*/
+	std::vector<int> Counts;
+
+
 	/*!
 		Contains the Component assignment for each vertex in Data. 
 		Only edges of destroyed components are updated to the new component color.
@@ -547,6 +639,31 @@ protected:
 	}
 
 
+	/*!
+		Runs the algorithm on the data Data views. 
+		Shared by the RunPersistence overloads.
+	*/
+	bool Run()
+	{
+		Init();
+
+		//If a user runs this on an empty vector, then they should not get the results of the previous run.
+		if (Data.empty()) return false;
+
+		CreateIndexValueVector();
+		Watershed();
+		SortPairedExtrema();
+#ifdef _DEBUG
+		VerifyAliveComponents();	
+#endif
+		//the input may not outlive the call, keep only its size for VerifyResults
+		Data.Floats = 0;
+		Data.Doubles = 0;
+		Data.Bytes = 0;
+		return true;
+	}
+
+
 	/*!
 		Initializes main data structures used in class:
 		- Sets Colors[] to NO_COLOR
@@ -579,12 +696,17 @@ protected:
 	/*!
 		Creates SortedData vector.
 		Assumes Data is already set.
+
+		Integer-valued data over a small range (e.g. 8-bit pixel profiles) is ordered 
+		with a counting sort in O(n), everything else with std::sort.
 	*/	
 	void CreateIndexValueVector()
 	{
 		if (Data.size()==0) return;
+
+		if (CountingSortIndexValueVector()) return;
 				
-		for (std::vector<float>::size_type i = 0; i != Data.size(); i++)
+		for (size_t i = 0; i != Data.size(); i++)
 		{
 			TIdxAndData dataidxpair; 
 
@@ -599,6 +721,55 @@ protected:
 	}
 
 
+	/*!
+		Counting sort version of CreateIndexValueVector.
+		Returns false, leaving SortedData untouched, if Data is not integer-valued 
+		or its range is too wide for buckets to pay off.
+
+		Vertices are distributed into buckets in index order, so equal values keep 
+		increasing indices - the same (value, index) order as TIdxAndData::operator<.
+	*/
+	bool CountingSortIndexValueVector()
+	{
+		float minValue = Data[0];
+		float maxValue = Data[0];
+
+		for (size_t i = 0; i != Data.size(); i++)
+		{
+			float value = Data[i];
+			//also rejects NaN and values an int cannot hold
+			if (!(value > -16777216.0f && value < 16777216.0f) || value != (float)(int)value) return false;
+			if (value < minValue) minValue = value;
+			if (value > maxValue) maxValue = value;
+		}
+
+		size_t range = (size_t)(maxValue - minValue) + 1;
+		if (range > COUNTING_SORT_MAX_RANGE || range > 4 * Data.size() + 256) return false;
+
+		int offset = (int)minValue;
+
+		//Counts[v+1] = number of vertices with value v, then prefix sums give bucket starts
+		Counts.assign(range + 1, 0);
+		for (size_t i = 0; i != Data.size(); i++)
+		{
+			Counts[(int)Data[i] - offset + 1]++;
+		}
+		for (size_t v = 1; v <= range; v++)
+		{
+			Counts[v] += Counts[v-1];
+		}
+
+		SortedData.resize(Data.size());
+		for (size_t i = 0; i != Data.size(); i++)
+		{
+			TIdxAndData &dataidxpair = SortedData[Counts[(int)Data[i] - offset]++];
+			dataidxpair.Data = Data[i];
+			dataidxpair.Idx = (int)i;
+		}
+		return true;
+	}
+
+
 	/*!
 		Main algorithm - all of the work happen here.
 
@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Benchmark of the Persistence1D orderings, see persistencebench.cpp.
+# Exits non-zero when the two orderings pair different extrema.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = persistencebench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += \
+    persistencebench.cpp
+
+include(measurecore.pri)
@@ -0,0 +1,146 @@
+// Checks that a Persistence1D workspace allocates nothing in steady state:
+// after Reserve(), repeated RunPersistence and GetPairedExtrema passes over
+// 8-bit, float and double profiles must not call operator new once. A counting
+// operator new replaces the global one for the whole program; only the
+// passes themselves are counted.
+//
+// Exits 0 when no pass allocated and every pair matches a fresh object's.
+
+#include "persistence1d.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace
+{
+
+bool counting = false;
+long allocations = 0;
+
+void* allocate(std::size_t size)
+{
+    if(counting)
+        allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace
+{
+
+const size_t maxSize = 1000;
+const int passes = 200;
+
+// random walk clipped to 0..255, like an 8-bit line profile
+std::vector<unsigned char> byteProfile(size_t count, unsigned &seed)
+{
+    std::vector<unsigned char> data(count);
+    int value = 128;
+    for(size_t i = 0; i < count; i++){
+        seed = seed*1103515245u + 12345u;
+        value = std::min(std::max(value + (int)((seed >> 16) % 13) - 6, 0), 255);
+        data[i] = (unsigned char)value;
+    }
+    return data;
+}
+
+bool samePairs(const std::vector<p1d::TPairedExtrema> &a, const std::vector<p1d::TPairedExtrema> &b)
+{
+    if(a.size() != b.size())
+        return false;
+    for(size_t i = 0; i < a.size(); i++)
+        if(a[i].MinIndex != b[i].MinIndex || a[i].MaxIndex != b[i].MaxIndex || a[i].Persistence != b[i].Persistence)
+            return false;
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    //inputs of every size up to maxSize: 8-bit, their float and double
+    //copies (the counting sort path) and smoothed floats (the std::sort path)
+    unsigned seed = 1;
+    std::vector< std::vector<unsigned char> > bytes;
+    std::vector< std::vector<float> > integers, smooth;
+    std::vector< std::vector<double> > doubles;
+    for(size_t count = 2; count <= maxSize; count += 37){
+        bytes.push_back(byteProfile(count, seed));
+        const std::vector<unsigned char> &b = bytes.back();
+        integers.push_back(std::vector<float>(b.begin(), b.end()));
+        doubles.push_back(std::vector<double>(b.begin(), b.end()));
+        std::vector<float> s(count);
+        for(size_t i = 0; i < count; i++)
+            s[i] = (b[i] + b[i > 0 ? i-1 : i] + b[i+1 < count ? i+1 : i]) / 3.0f;
+        smooth.push_back(s);
+    }
+    bytes.push_back(std::vector<unsigned char>(maxSize, 7));     //flat
+    integers.push_back(std::vector<float>(maxSize, 7));
+    doubles.push_back(std::vector<double>(maxSize, 7));
+    smooth.push_back(std::vector<float>(maxSize, 0.5f));
+
+    //expected pairs from a fresh object per input, allocations not counted
+    std::vector< std::vector<p1d::TPairedExtrema> > expected(bytes.size());
+    for(size_t n = 0; n < bytes.size(); n++){
+        p1d::Persistence1D fresh;
+        fresh.RunPersistence(integers[n]);
+        fresh.GetPairedExtrema(expected[n], 0);
+    }
+
+    //the counter itself sees a fresh object's buffers
+    counting = true;
+    {
+        p1d::Persistence1D fresh;
+        fresh.RunPersistence(integers[0]);
+    }
+    counting = false;
+    if(allocations == 0){
+        std::printf("operator new is not counted\n");
+        return 1;
+    }
+    allocations = 0;
+
+    p1d::Persistence1D p;
+    p.Reserve(maxSize);
+    std::vector<p1d::TPairedExtrema> pairs;
+    pairs.reserve(maxSize / 2 + 1);
+    const float thresholds[] = { 0, 4, 12.5f };
+
+    bool matches = true;
+    counting = true;
+    for(int pass = 0; pass < passes; pass++){
+        for(size_t n = 0; n < bytes.size(); n++){
+            p.RunPersistence(bytes[n].data(), bytes[n].size());
+            p.GetPairedExtrema(pairs, 0);
+            matches = matches && samePairs(pairs, expected[n]);
+            p.RunPersistence(integers[n].data(), integers[n].size());
+            p.GetPairedExtrema(pairs, 0);
+            matches = matches && samePairs(pairs, expected[n]);
+            p.RunPersistence(doubles[n].data(), doubles[n].size());
+            p.GetPairedExtrema(pairs, 0);
+            matches = matches && samePairs(pairs, expected[n]);
+            p.RunPersistence(smooth[n]);
+            for(int t = 0; t < 3; t++)
+                p.GetPairedExtrema(pairs, thresholds[t]);
+        }
+    }
+    counting = false;
+
+    std::printf("%d passes over %d profiles: %ld allocations, pairs %s\n",
+                passes, (int)bytes.size(), allocations, matches ? "match" : "DIFFER");
+    return (allocations == 0 && matches) ? 0 : 1;
+}
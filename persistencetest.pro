@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Allocation test of the reusable Persistence1D workspace, see
+# persistencetest.cpp. Exits non-zero on failure.
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = persistencetest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += \
+    persistencetest.cpp
+
+include(measurecore.pri)
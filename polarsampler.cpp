@@ -0,0 +1,146 @@
+#include "polarsampler.h"
+#include "linesampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+PolarGeometry::PolarGeometry() :
+    radius(0),
+    angle(0),
+    angleStep(0),
+    rays(0),
+    step(1.0),
+    width(1)
+{
+}
+
+bool PolarGeometry::operator==(const PolarGeometry &other) const
+{
+    return center == other.center && radius == other.radius && angle == other.angle
+            && angleStep == other.angleStep && rays == other.rays && step == other.step
+            && width == other.width;
+}
+
+int PolarGeometry::count() const
+{
+    return (int)std::floor(radius / step + 1e-9) + 1;
+}
+
+cv::Point2f PolarGeometry::direction(int ray) const
+{
+    double theta = angle + ray*angleStep;
+    return cv::Point2f((float)std::cos(theta), (float)std::sin(theta));
+}
+
+cv::Rect PolarGeometry::bounds(cv::Size image) const
+{
+    //the disc, plus half the strip and 2 pixels of bicubic support
+    int pad = (int)std::ceil(radius) + width/2 + 3;
+    cv::Rect disc(cvFloor(center.x) - pad, cvFloor(center.y) - pad, 2*pad + 2, 2*pad + 2);
+    cv::Rect inside = disc & cv::Rect(0, 0, image.width, image.height);
+    if(inside.area() == 0){     //the disc misses the image, every sample repeats its nearest pixel
+        int x = std::min(std::max(cvFloor(center.x), 0), image.width-1);
+        int y = std::min(std::max(cvFloor(center.y), 0), image.height-1);
+        inside = cv::Rect(x, y, 1, 1);
+    }
+    return inside;
+}
+
+PolarSampler::PolarSampler() :
+    m_sourceData(0)
+{
+}
+
+void PolarSampler::releaseSource()
+{
+    m_source.release();
+    m_sourceData = 0;
+}
+
+void PolarSampler::sample(const cv::Mat &image, const PolarGeometry &geometry, int interpolation, bool median,
+                          cv::Mat &profiles)
+{
+    CV_Assert(samplerType(image.type()) && geometry.rays > 0 && geometry.step > 0);
+
+    if(m_mapX.empty() || geometry != m_geometry || image.size() != m_imageSize)
+        buildMaps(geometry, image.size());
+
+    //remap of a float copy keeps the fractional grey levels the line
+    //samplers give, an integer remap would round them away; made once per
+    //image and area, new rays or strips of the same image reuse it
+    if(image.data != m_sourceData || image.size() != m_sourceSize || m_bounds != m_sourceBounds){
+        image(m_bounds).convertTo(m_source, CV_32F);
+        m_sourceData = image.data;
+        m_sourceSize = image.size();
+        m_sourceBounds = m_bounds;
+    }
+    bool clip = (interpolation == cv::INTER_CUBIC && image.depth() != CV_32F);
+    double high = (image.depth() == CV_16U) ? 65535 : 255;
+
+    int width = std::max(geometry.width, 1);
+    int count = geometry.count();
+    profiles.create(geometry.rays, count, CV_64F);
+    StripReducer reducer(width, median);
+
+    cv::parallel_for_(cv::Range(0, geometry.rays), [&](const cv::Range &range){
+        cv::Mat mapX,mapY,strip;
+        for(int n = range.start; n < range.end; n++){
+            //the strip of ray n: its centre line moved along the normal,
+            //one row per line across it (the centre line alone for width 1)
+            if(width == 1){
+                mapX = m_mapX.row(n);
+                mapY = m_mapY.row(n);
+            }
+            else{
+                mapX.create(width, count, CV_32F);
+                mapY.create(width, count, CV_32F);
+                cv::Point2f d = geometry.direction(n);
+                cv::Point2f normal(d.y, -d.x);      //lineNormal of the ray
+                const float *cx = m_mapX.ptr<float>(n), *cy = m_mapY.ptr<float>(n);
+                for(int k = 0; k < width; k++){
+                    float t = k - (width-1) * 0.5f;
+                    float ox = t*normal.x, oy = t*normal.y;
+                    float *mx = mapX.ptr<float>(k), *my = mapY.ptr<float>(k);
+                    for(int i = 0; i < count; i++){
+                        mx[i] = cx[i] + ox;
+                        my[i] = cy[i] + oy;
+                    }
+                }
+            }
+            cv::remap(m_source, strip, mapX, mapY, interpolation, cv::BORDER_REPLICATE);
+            if(clip){   //to the range of the pixel type, like the line samplers
+                cv::max(strip, 0, strip);
+                cv::min(strip, high, strip);
+            }
+            reducer.reduce(strip.ptr<float>(), strip.step / sizeof(float), count, profiles.ptr<double>(n));
+        }
+    });
+}
+
+void PolarSampler::buildMaps(const PolarGeometry &g, cv::Size image)
+{
+    m_geometry = g;
+    m_imageSize = image;
+    m_bounds = g.bounds(image);
+
+    int count = g.count();
+    m_mapX.create(g.rays, count, CV_32F);
+    m_mapY.create(g.rays, count, CV_32F);
+
+    cv::parallel_for_(cv::Range(0, g.rays), [&](const cv::Range &range){
+        for(int n = range.start; n < range.end; n++){
+            cv::Point2f d = g.direction(n);
+            float x0 = g.center.x - m_bounds.x, y0 = g.center.y - m_bounds.y;
+            float dx = (float)(d.x*g.step), dy = (float)(d.y*g.step);
+            float *mx = m_mapX.ptr<float>(n);
+            float *my = m_mapY.ptr<float>(n);
+            for(int i = 0; i < count; i++){
+                mx[i] = x0 + i*dx;
+                my[i] = y0 + i*dy;
+            }
+        }
+    });
+}
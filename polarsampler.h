@@ -0,0 +1,76 @@
+#ifndef POLARSAMPLER_H
+#define POLARSAMPLER_H
+
+#include <opencv2/core/core.hpp>
+
+// Rays from one centre, as the circle measurement casts them, resampled by
+// cv::remap into an (angle x radius) image: row n is ray n, column i the
+// sample i*step pixels out from the centre. Every ray is then a contiguous
+// row and the edge search is a batch over rows.
+
+struct PolarGeometry
+{
+    PolarGeometry();
+
+    bool operator==(const PolarGeometry &other) const;
+    bool operator!=(const PolarGeometry &other) const { return !(*this == other); }
+
+    cv::Point2f center;
+    float radius;           // ray length, the samples run from 0 to radius
+    double angle;           // direction of the first ray, radians, image axes (y down)
+    double angleStep;       // radians between rays
+    int rays;
+    double step;            // pixels between samples along a ray
+    int width;              // strip across each ray, as in sampleStrip
+
+    int count() const;                          // samples per ray
+    cv::Point2f direction(int ray) const;       // unit vector
+    cv::Rect bounds(cv::Size image) const;      // image area the samples read
+};
+
+// Keeps the remap tables of the last geometry, so changing only the
+// smoothing or the image resamples without rebuilding them. The tables
+// hold the centre line of each ray, rays x count(); the strip of a ray is
+// built from its row and reduced straight away, so memory does not grow
+// with the strip width. The CV_32F copy of the image area the rays read is
+// kept as well, for the same image (its data pointer and size) and area.
+// Not thread safe; one per MeasureCore.
+//
+// Pixel steps (INTER_NEAREST, step 1) read the nearest pixel every unit
+// length along the exact ray. That is not the cv::LineIterator walk the
+// parallel lines use: on a diagonal ray the samples are 1 pixel apart
+// instead of up to 1.41, so the profile is longer and may pick other
+// pixels than the ray the dialog draws.
+class PolarSampler
+{
+public:
+    PolarSampler();
+
+    // profiles: CV_64F, rays rows by count() columns. With width > 1 each
+    // sample is the mean, or the median, of the strip across the ray at
+    // that point, spread along the ray's normal as in sampleStrip.
+    // "interpolation" is cv::INTER_NEAREST, INTER_LINEAR or INTER_CUBIC;
+    // bicubic values are clipped to the range of the pixel type like
+    // sampleLine: 0..255 for 8-bit, 0..65535 for 16-bit, float unclipped.
+    // Pixels outside the image repeat the border.
+    void sample(const cv::Mat &image, const PolarGeometry &geometry, int interpolation, bool median,
+                cv::Mat &profiles);
+
+    // Forgets the float copy; call it when pixels of an image sampled
+    // before change in place, with the same data pointer.
+    void releaseSource();
+
+private:
+    void buildMaps(const PolarGeometry &geometry, cv::Size image);
+
+    PolarGeometry m_geometry;   // geometry the maps were built for
+    cv::Size m_imageSize;
+    cv::Rect m_bounds;
+    cv::Mat m_mapX,m_mapY;      // ray centre lines, relative to m_bounds
+    cv::Mat m_source;           // m_sourceBounds of the image at m_sourceData as CV_32F
+    const uchar *m_sourceData;
+    cv::Size m_sourceSize;
+    cv::Rect m_sourceBounds;
+};
+
+#endif // POLARSAMPLER_H
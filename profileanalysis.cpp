@@ -0,0 +1,65 @@
+#include "profileanalysis.h"
+
+#include <algorithm>
+
+ProfileAnalysis::ProfileAnalysis()
+{
+}
+
+void ProfileAnalysis::setProfile(const std::vector<double> &values)
+{
+    setProfile(values.data(), (int)values.size());
+}
+
+void ProfileAnalysis::setProfile(const double *values, int count)
+{
+    m_values.assign(values, values + count);
+    m_persistence.RunPersistence(m_values.data(), m_values.size());
+}
+
+void ProfileAnalysis::clear()
+{
+    m_values.clear();
+}
+
+void ProfileAnalysis::peaks(double amplitude, std::vector<double> &outputX, std::vector<double> &outputY) const
+{
+    const std::vector<double> &dataY = m_values;
+    const p1d::Persistence1D &p = m_persistence;
+
+    outputX.clear();
+    outputY.clear();
+
+    if(dataY.empty())
+        return;
+
+    std::vector< p1d::TPairedExtrema > &Extrema = m_pairs;
+    p.GetPairedExtrema(Extrema, (float)amplitude);
+
+    if(Extrema.size())
+        for(std::vector< p1d::TPairedExtrema >::iterator it2 = Extrema.begin(); it2 != Extrema.end(); it2++){
+            outputX.push_back((*it2).MaxIndex);
+            outputX.push_back((*it2).MinIndex);
+        }
+
+    if(outputX.size()<1){
+        float dataMaximum=0;    //float, the profile of a float image lies within 0..1
+        int GetGlobalMaximum=0;
+        for(int i =0;i<dataY.size();i++)
+        {
+            if((float)dataY[i]>dataMaximum){     //as the float persistence input compares it
+                dataMaximum = (float)dataY[i];
+                GetGlobalMaximum = i;
+            }
+        }
+        if(dataMaximum-p.GetGlobalMinimumValue() > amplitude)
+            outputX.push_back(GetGlobalMaximum);
+    }
+    outputX.push_back(p.GetGlobalMinimumIndex());
+
+    std::sort(outputX.begin(),outputX.end());
+
+    for(int i=0 ;i<outputX.size() ;i++){
+        outputY.push_back((float)dataY[outputX[i]]);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef PROFILEANALYSIS_H
+#define PROFILEANALYSIS_H
+
+#include "persistence1d.hpp"
+
+#include <vector>
+
+// Persistence of one intensity profile, computed once when the profile is
+// set and then queried for any amplitude threshold. The pairs are already
+// sorted by persistence, so a threshold change is a lower_bound plus a copy
+// instead of a new RunPersistence.
+class ProfileAnalysis
+{
+public:
+    ProfileAnalysis();
+
+    void setProfile(const std::vector<double> &values);
+    void setProfile(const double *values, int count);      // a row of a profile matrix
+    void clear();
+
+    const std::vector<double>& values() const { return m_values; }
+    bool empty() const { return m_values.empty(); }
+
+    // Paired extrema with persistence >= amplitude plus the global minimum,
+    // as sorted sample indexes (outputX) and their values (outputY). With no
+    // pair left the global maximum is used if it stands out by amplitude.
+    void peaks(double amplitude, std::vector<double> &outputX, std::vector<double> &outputY) const;
+
+private:
+    std::vector<double> m_values;                       // also the persistence input, read in place
+    p1d::Persistence1D m_persistence;
+    mutable std::vector<p1d::TPairedExtrema> m_pairs;   // scratch for peaks()
+};
+
+#endif // PROFILEANALYSIS_H
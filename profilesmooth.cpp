@@ -0,0 +1,130 @@
+#include "profilesmooth.h"
+#include "linesampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+cv::Point2d lineNormal(cv::Point2f a, cv::Point2f b)
+{
+    double L = std::sqrt((double)(a.x-b.x)*(a.x-b.x) + (double)(a.y-b.y)*(a.y-b.y));
+    if(L == 0)
+        return cv::Point2d(0, 0);
+    return cv::Point2d((double)(b.y-a.y) / L, (double)(a.x-b.x) / L);
+}
+
+namespace
+{
+
+template<typename P>
+void sampleProfileT(const cv::Mat &image, const std::vector<cv::Point2f> &points,
+                    cv::Point2d normal, int width, bool median, std::vector<double> &profile)
+{
+    if(width <= 1){
+        for(size_t i = 0; i < points.size(); i++)
+            profile[i] = image.at<P>(cvRound(points[i].y), cvRound(points[i].x));
+        return;
+    }
+
+    //offsets across the line are the same for every sample: as element
+    //offsets when the strip of a sample is inside the image, no clamps
+    std::vector<cv::Point> across(width);
+    std::vector<ptrdiff_t> offsets(width);
+    ptrdiff_t stride = (ptrdiff_t)(image.step / sizeof(P));
+    for(int k = 0; k < width; k++){
+        double t = k - (width-1) * 0.5;
+        across[k] = cv::Point(cvRound(t*normal.x), cvRound(t*normal.y));
+        offsets[k] = across[k].y*stride + across[k].x;
+    }
+    cv::Rect box = cv::boundingRect(across);
+
+    //the median gathers a block of samples as float rows, one per line
+    //across the strip, and reduces them like sampleStrip; the mean sums
+    //each sample's column straight away
+    const int block = 256;
+    StripReducer reducer(width, median);
+    cv::AutoBuffer<float> buffer(median ? (size_t)width*block : width);
+    size_t step = median ? block : 1;
+    int count = (int)points.size();
+    for(int i0 = 0; i0 < count; i0 += block){
+        int n = std::min(block, count - i0);
+        for(int i = 0; i < n; i++){
+            int px = cvRound(points[i0+i].x), py = cvRound(points[i0+i].y);
+            float *column = median ? buffer + i : buffer;
+            if(px + box.x >= 0 && py + box.y >= 0 &&
+               px + box.x + box.width <= image.cols && py + box.y + box.height <= image.rows){
+                const P *base = image.ptr<P>(py) + px;
+                for(int k = 0; k < width; k++)
+                    column[k*step] = base[offsets[k]];
+            }else{
+                for(int k = 0; k < width; k++){
+                    int x = std::min(std::max(px + across[k].x, 0), image.cols-1);
+                    int y = std::min(std::max(py + across[k].y, 0), image.rows-1);
+                    column[k*step] = image.at<P>(y, x);
+                }
+            }
+            if(!median){
+                double sum = 0;
+                for(int k = 0; k < width; k++)
+                    sum += column[k];
+                profile[i0+i] = sum / width;
+            }
+        }
+        if(median)
+            reducer.reduce(buffer, block, n, &profile[i0]);
+    }
+}
+
+} // namespace
+
+void sampleProfile(const cv::Mat &image, const std::vector<cv::Point2f> &points,
+                   cv::Point2d normal, int width, bool median, std::vector<double> &profile)
+{
+    CV_Assert(samplerType(image.type()));
+
+    profile.resize(points.size());
+    switch(image.depth()){
+    case CV_8U:  sampleProfileT<uchar>(image, points, normal, width, median, profile); break;
+    case CV_16U: sampleProfileT<ushort>(image, points, normal, width, median, profile); break;
+    default:     sampleProfileT<float>(image, points, normal, width, median, profile); break;
+    }
+}
+
+void gaussianSmooth1D(const std::vector<double> &in, std::vector<double> &out, int kernel)
+{
+    int n = (int)in.size();
+    if(kernel <= 1 || n == 0){
+        out = in;
+        return;
+    }
+
+    cv::Mat k = cv::getGaussianKernel(kernel, 0, CV_64F);
+    const double *kw = k.ptr<double>();
+    int r = kernel/2;
+
+    //reflect-101 padded copy so the inner loop has no border checks
+    std::vector<double> padded(n + 2*r);
+    for(int i = -r; i < n+r; i++)
+        padded[i+r] = in[cv::borderInterpolate(i, n, cv::BORDER_REFLECT_101)];
+
+    out.assign(n, 0.0);
+    double *o = out.data();
+    const double *p = padded.data();
+
+    //one kernel tap at a time over the whole profile: contiguous, SIMD friendly
+    for(int j = 0; j < kernel; j++){
+        const double *src = p + j;
+        double w = kw[j];
+        int i = 0;
+#if CV_SIMD128_64F
+        cv::v_float64x2 vw = cv::v_setall_f64(w);
+        for(; i <= n-2; i += 2)
+            cv::v_store(o+i, cv::v_load(o+i) + vw*cv::v_load(src+i));
+#endif
+        for(; i < n; i++)
+            o[i] += w*src[i];
+    }
+}
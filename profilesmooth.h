@@ -0,0 +1,26 @@
+#ifndef PROFILESMOOTH_H
+#define PROFILESMOOTH_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// Smoothing applied to a sampled intensity profile instead of the image.
+// The cost is O(profile length) per line, whatever the image size, and
+// nothing outside the measured line is touched.
+
+// Unit normal of the line a->b, the same direction the offset lines use.
+cv::Point2d lineNormal(cv::Point2f a, cv::Point2f b);
+
+// Pixel values under "points" (any image samplerType() takes), rounded to
+// the nearest pixel. With width > 1 each sample is the mean, or the median, of "width"
+// pixels spread along "normal", centred on the point; pixels outside the
+// image are clamped to the border.
+void sampleProfile(const cv::Mat &image, const std::vector<cv::Point2f> &points,
+                   cv::Point2d normal, int width, bool median, std::vector<double> &profile);
+
+// 1-D Gaussian along the profile with the kernel and sigma cv::GaussianBlur
+// would use, BORDER_REFLECT_101 at both ends.
+void gaussianSmooth1D(const std::vector<double> &in, std::vector<double> &out, int kernel);
+
+#endif // PROFILESMOOTH_H
@@ -0,0 +1,213 @@
+#include "recursivegaussian.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace
+{
+
+// w[n] = B*x[n] + c1*w[n-1] + c2*w[n-2] + c3*w[n-3], same for the backward pass
+struct YvVCoefficients
+{
+    float B, c1, c2, c3;
+};
+
+YvVCoefficients youngVanVliet(double sigma)
+{
+    double q;
+    if(sigma >= 2.5)
+        q = 0.98711*sigma - 0.96330;
+    else
+        q = 3.97156 - 4.14554*std::sqrt(1.0 - 0.26891*std::max(sigma, 0.5));
+
+    double q2 = q*q, q3 = q2*q;
+    double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+    double b1 = 2.44413*q + 2.85619*q2 + 1.26661*q3;
+    double b2 = -(1.4281*q2 + 1.26661*q3);
+    double b3 = 0.422205*q3;
+
+    YvVCoefficients k;
+    k.c1 = (float)(b1/b0);
+    k.c2 = (float)(b2/b0);
+    k.c3 = (float)(b3/b0);
+    k.B  = 1.0f - (k.c1 + k.c2 + k.c3);     // unit DC gain
+    return k;
+}
+
+// out = B*in + c1*s1 + c2*s2 + c3*s3 over a whole row
+void iirRow(const float *in, const float *s1, const float *s2, const float *s3,
+            float *out, int n, const YvVCoefficients &k)
+{
+    int x = 0;
+#if CV_SIMD128
+    cv::v_float32x4 vB = cv::v_setall_f32(k.B);
+    cv::v_float32x4 vc1 = cv::v_setall_f32(k.c1);
+    cv::v_float32x4 vc2 = cv::v_setall_f32(k.c2);
+    cv::v_float32x4 vc3 = cv::v_setall_f32(k.c3);
+    for(; x <= n-4; x += 4){
+        cv::v_float32x4 v = vB*cv::v_load(in+x) + vc1*cv::v_load(s1+x)
+                + vc2*cv::v_load(s2+x) + vc3*cv::v_load(s3+x);
+        cv::v_store(out+x, v);
+    }
+#endif
+    for(; x < n; x++)
+        out[x] = k.B*in[x] + k.c1*s1[x] + k.c2*s2[x] + k.c3*s3[x];
+}
+
+// "n" integer pixels widened to floats
+template<typename P>
+void widen(const P *p, int n, float *out);
+
+template<>
+void widen<uchar>(const uchar *p, int n, float *out)
+{
+    int x = 0;
+#if CV_SIMD128
+    for(; x <= n-16; x += 16){
+        cv::v_uint16x8 lo16, hi16;
+        cv::v_uint32x4 a, b, c, d;
+        cv::v_expand(cv::v_load(p+x), lo16, hi16);
+        cv::v_expand(lo16, a, b);
+        cv::v_expand(hi16, c, d);
+        cv::v_store(out+x,    cv::v_cvt_f32(cv::v_reinterpret_as_s32(a)));
+        cv::v_store(out+x+4,  cv::v_cvt_f32(cv::v_reinterpret_as_s32(b)));
+        cv::v_store(out+x+8,  cv::v_cvt_f32(cv::v_reinterpret_as_s32(c)));
+        cv::v_store(out+x+12, cv::v_cvt_f32(cv::v_reinterpret_as_s32(d)));
+    }
+#endif
+    for(; x < n; x++)
+        out[x] = p[x];
+}
+
+template<>
+void widen<ushort>(const ushort *p, int n, float *out)
+{
+    int x = 0;
+#if CV_SIMD128
+    for(; x <= n-8; x += 8){
+        cv::v_uint32x4 a, b;
+        cv::v_expand(cv::v_load(p+x), a, b);
+        cv::v_store(out+x,   cv::v_cvt_f32(cv::v_reinterpret_as_s32(a)));
+        cv::v_store(out+x+4, cv::v_cvt_f32(cv::v_reinterpret_as_s32(b)));
+    }
+#endif
+    for(; x < n; x++)
+        out[x] = p[x];
+}
+
+// row "r" of "src" as floats; integer rows are widened into "scratch"
+const float* rowAsFloat(const cv::Mat &src, int r, float *scratch)
+{
+    switch(src.depth()){
+    case CV_8U:
+        widen(src.ptr<uchar>(r), src.cols, scratch);
+        return scratch;
+    case CV_16U:
+        widen(src.ptr<ushort>(r), src.cols, scratch);
+        return scratch;
+    default:
+        return src.ptr<float>(r);
+    }
+}
+
+// Forward and backward recursion down the columns of "src" (CV_8U, CV_16U or CV_32F)
+// into "dst" (CV_32F). "pad" reflected rows on each end warm up the filter.
+void verticalPass(const cv::Mat &src, cv::Mat &dst, const YvVCoefficients &k, int pad)
+{
+    int rows = src.rows, cols = src.cols;
+    dst.create(rows, cols, CV_32F);
+
+    std::vector<float> scratch(cols);
+    cv::Mat head(3, cols, CV_32F);          // rolling w[n-1..n-3] before row 0
+    cv::Mat tail(pad+3, cols, CV_32F);      // forward output past the last row
+
+    // forward (causal) pass, starting in steady state on the first padded row
+    const float *first = rowAsFloat(src, cv::borderInterpolate(-pad, rows, cv::BORDER_REFLECT_101), scratch.data());
+    for(int i = 0; i < 3; i++)
+        std::copy(first, first+cols, head.ptr<float>(i));
+
+    const float *s1 = head.ptr<float>(0), *s2 = head.ptr<float>(1), *s3 = head.ptr<float>(2);
+    std::vector<float> warm(3*cols);
+    for(int r = -pad; r < rows+pad; r++){
+        const float *in = rowAsFloat(src, cv::borderInterpolate(r, rows, cv::BORDER_REFLECT_101), scratch.data());
+        float *out;
+        if(r < 0)
+            out = &warm[((r+pad)%3)*cols];  // padded rows above only feed the state
+        else if(r < rows)
+            out = dst.ptr<float>(r);
+        else
+            out = tail.ptr<float>(r-rows);
+        iirRow(in, s1, s2, s3, out, cols, k);
+        s3 = s2; s2 = s1; s1 = out;
+    }
+
+    // backward (anti-causal) pass, in place over the forward output
+    const float *last = tail.ptr<float>(pad-1);
+    for(int i = 0; i < 3; i++)
+        std::copy(last, last+cols, head.ptr<float>(i));
+    s1 = head.ptr<float>(0); s2 = head.ptr<float>(1); s3 = head.ptr<float>(2);
+    for(int r = rows+pad-1; r >= 0; r--){
+        float *row = (r < rows) ? dst.ptr<float>(r) : tail.ptr<float>(r-rows);
+        iirRow(row, s1, s2, s3, row, cols, k);
+        s3 = s2; s2 = s1; s1 = row;
+    }
+}
+
+} // namespace
+
+double kernelSigma(int kernel)
+{
+    return 0.3*((kernel-1)*0.5 - 1) + 0.8;
+}
+
+int recursiveGaussianMargin(double sigma)
+{
+    return cvCeil(4*sigma) + 3;
+}
+
+void recursiveGaussianBlur(const cv::Mat &src, cv::Mat &dst, double sigma)
+{
+    CV_Assert(src.channels() == 1 && (src.depth() == CV_8U || src.depth() == CV_16U || src.depth() == CV_32F));
+
+    YvVCoefficients k = youngVanVliet(sigma);
+    int pad = recursiveGaussianMargin(sigma);
+
+    // columns first, then the rows of the transposed image, so both passes
+    // walk contiguous rows
+    cv::Mat vert, vertT, horz;
+    verticalPass(src, vert, k, pad);
+    cv::transpose(vert, vertT);
+    verticalPass(vertT, horz, k, pad);
+    cv::transpose(horz, vert);
+    vert.convertTo(dst, src.type());
+}
+
+BlurAccuracy compareWithGaussianBlur(const cv::Mat &image, int kernel, double greyLevel, const cv::Rect &region)
+{
+    BlurAccuracy acc;
+    acc.kernel = kernel;
+    acc.sigma = kernelSigma(kernel);
+
+    cv::Rect inside = region & cv::Rect(0, 0, image.cols, image.rows);
+    int margin = recursiveGaussianMargin(acc.sigma);
+    cv::Rect grown(inside.x-margin, inside.y-margin, inside.width+2*margin, inside.height+2*margin);
+    grown &= cv::Rect(0, 0, image.cols, image.rows);
+
+    cv::Mat reference, recursive, diff;
+    cv::GaussianBlur(image(inside), reference, cv::Size(kernel,kernel), 0, 0);
+    recursiveGaussianBlur(image(grown), recursive, acc.sigma);
+    recursive = recursive(inside - grown.tl());
+
+    cv::absdiff(reference, recursive, diff);
+    diff.convertTo(diff, CV_64F);
+
+    cv::minMaxLoc(diff, 0, &acc.maxAbsDiff);
+    acc.meanAbsDiff = cv::mean(diff)[0];
+    acc.rmsDiff = std::sqrt(cv::mean(diff.mul(diff))[0]);
+    acc.offByMoreThanOne = diff.total() ? (double)cv::countNonZero(diff > greyLevel) / diff.total() : 0.0;
+    return acc;
+}
@@ -0,0 +1,42 @@
+#ifndef RECURSIVEGAUSSIAN_H
+#define RECURSIVEGAUSSIAN_H
+
+#include <opencv2/core/core.hpp>
+
+// Recursive (IIR) Gaussian smoothing after Young & van Vliet (1995).
+// A causal and an anti-causal 3rd order filter are run along the columns
+// and then along the rows, so the cost per pixel is the same for every
+// sigma, unlike cv::GaussianBlur whose cost grows with the kernel size.
+// Borders are extended with BORDER_REFLECT_101 like cv::GaussianBlur.
+//
+// Both passes run down the image, one row at a time, so every step works on
+// whole contiguous rows and uses the SIMD path. CV_8UC1, CV_16UC1 and
+// CV_32FC1 are supported; the result has the type of "src".
+void recursiveGaussianBlur(const cv::Mat &src, cv::Mat &dst, double sigma);
+
+// Sigma cv::GaussianBlur derives from a kernel size when it is given sigma 0.
+double kernelSigma(int kernel);
+
+// Pixels outside a region that still influence it noticeably. Blurring a
+// region grown by this margin gives the same result as a full-frame pass.
+int recursiveGaussianMargin(double sigma);
+
+// Difference between recursiveGaussianBlur and cv::GaussianBlur for the same
+// kernel size, in grey levels of "image".
+struct BlurAccuracy
+{
+    int kernel;
+    double sigma;
+    double maxAbsDiff;
+    double meanAbsDiff;
+    double rmsDiff;
+    double offByMoreThanOne;    // fraction of pixels off by more than one 8-bit grey level
+};
+
+// "greyLevel" is one 8-bit grey level in pixel values of "image", see
+// amplitudeScale(): 1 for CV_8U, (2^bits - 1) / 255 for 16-bit, 1/255 for float.
+// Only "region" is compared, blurred the way a region of BlurCache is: the
+// recursive pass over the region grown by recursiveGaussianMargin().
+BlurAccuracy compareWithGaussianBlur(const cv::Mat &image, int kernel, double greyLevel, const cv::Rect &region);
+
+#endif // RECURSIVEGAUSSIAN_H
@@ -0,0 +1,244 @@
+#include "resultsink.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+const char columnarMagic[8] = {'M','E','A','S','C','O','L','1'};
+const size_t streamBuffer = 1 << 20;
+
+// Opens "path" for append, through "buffer" when one is given; "empty"
+// tells whether the file has nothing in it yet, so the header still has to
+// be written.
+std::FILE* openAppend(const std::string &path, std::vector<char> *buffer, bool &empty)
+{
+    std::FILE *file = std::fopen(path.c_str(), "ab");
+    if(!file)
+        return 0;
+    if(buffer){
+        buffer->resize(streamBuffer);
+        std::setvbuf(file, buffer->data(), _IOFBF, buffer->size());
+    }
+    std::fseek(file, 0, SEEK_END);
+    empty = (std::ftell(file) == 0);
+    return file;
+}
+
+// An existing file must start with the magic of the columnar format.
+bool columnarOrEmpty(const std::string &path)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if(!file)
+        return true;
+    char magic[sizeof(columnarMagic)];
+    size_t n = std::fread(magic, 1, sizeof(magic), file);
+    std::fclose(file);
+    return n == 0 || (n == sizeof(magic) && std::memcmp(magic, columnarMagic, n) == 0);
+}
+
+template<typename T>
+bool writeColumn(std::FILE *file, const std::vector<T> &column)
+{
+    return column.empty() || std::fwrite(column.data(), sizeof(T), column.size(), file) == column.size();
+}
+
+bool writeU32(std::FILE *file, unsigned int value)
+{
+    return std::fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+bool endsWith(const std::string &text, const char *suffix)
+{
+    size_t n = std::strlen(suffix);
+    if(text.size() < n)
+        return false;
+    for(size_t i = 0; i < n; i++){
+        char c = text[text.size()-n+i];
+        if(c >= 'A' && c <= 'Z')
+            c += 'a'-'A';
+        if(c != suffix[i])
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+MeasureRecord::MeasureRecord() :
+    index(0),
+    ok(true),
+    lineFitted(false),
+    circleFitted(false),
+    radius(0)
+{
+}
+
+std::string csvQuote(const std::string &text)
+{
+    std::string quoted(1, '"');
+    quoted.reserve(text.size() + 2);
+    for(size_t i = 0; i < text.size(); i++){
+        if(text[i] == '"')
+            quoted += '"';
+        quoted += text[i];
+    }
+    quoted += '"';
+    return quoted;
+}
+
+CsvResultSink::CsvResultSink(const std::string &path)
+{
+    bool empty = false;
+    m_file = openAppend(path, &m_buffer, empty);
+    if(m_file && empty)
+        std::fputs("index,image,kind,line,x,y,value\n", m_file);
+}
+
+CsvResultSink::~CsvResultSink()
+{
+    if(m_file)
+        std::fclose(m_file);
+}
+
+bool CsvResultSink::write(const MeasureRecord &r)
+{
+    if(!m_file)
+        return false;
+
+    std::string quoted = csvQuote(r.image);
+    const char *name = quoted.c_str();
+    if(!r.ok)
+        return std::fprintf(m_file, "%d,%s,unreadable,,,,\n", r.index, name) > 0;
+
+    for(size_t n = 0; n < r.lines.size(); n++){
+        const std::vector<cv::Point3f> &edges = r.lines[n];
+        for(size_t i = 0; i < edges.size(); i++)
+            std::fprintf(m_file, "%d,%s,edge,%d,%.2f,%.2f,%d\n", r.index, name, (int)n, edges[i].x, edges[i].y, (int)edges[i].z);
+    }
+    if(r.lineFitted){
+        std::fprintf(m_file, "%d,%s,line,,%d,%d,\n", r.index, name, r.p1.x, r.p1.y);
+        std::fprintf(m_file, "%d,%s,line,,%d,%d,\n", r.index, name, r.p2.x, r.p2.y);
+    }
+    if(r.circleFitted)
+        std::fprintf(m_file, "%d,%s,circle,,%.2f,%.2f,%.2f\n", r.index, name, r.center.x, r.center.y, r.radius);
+
+    return !std::ferror(m_file);
+}
+
+bool CsvResultSink::flush()
+{
+    return m_file && std::fflush(m_file) == 0;
+}
+
+ColumnarResultSink::ColumnarResultSink(const std::string &path, int chunkRecords) :
+    m_file(0),
+    m_chunkRecords(std::max(chunkRecords, 1))
+{
+    bool empty = false;
+    if(!columnarOrEmpty(path))
+        return;
+    m_file = openAppend(path, 0, empty);     //chunks already go out as whole columns
+    if(m_file && empty)
+        std::fwrite(columnarMagic, 1, sizeof(columnarMagic), m_file);
+}
+
+ColumnarResultSink::~ColumnarResultSink()
+{
+    if(m_file){
+        writeChunk();
+        std::fclose(m_file);
+    }
+}
+
+bool ColumnarResultSink::write(const MeasureRecord &r)
+{
+    if(!m_file)
+        return false;
+
+    unsigned int edges = 0;
+    for(size_t n = 0; n < r.lines.size(); n++){
+        for(size_t i = 0; i < r.lines[n].size(); i++){
+            const cv::Point3f &p = r.lines[n][i];
+            m_edgeLine.push_back((unsigned int)n);
+            m_edgeX.push_back(p.x);
+            m_edgeY.push_back(p.y);
+            m_edgeSlope.push_back((unsigned char)p.z);
+        }
+        edges += (unsigned int)r.lines[n].size();
+    }
+
+    m_index.push_back(r.index);
+    m_flags.push_back((r.ok ? 1 : 0) | (r.lineFitted ? 2 : 0) | (r.circleFitted ? 4 : 0));
+    m_lineCount.push_back((unsigned int)r.lines.size());
+    m_edgeCount.push_back(edges);
+    m_x1.push_back(r.p1.x);
+    m_y1.push_back(r.p1.y);
+    m_x2.push_back(r.p2.x);
+    m_y2.push_back(r.p2.y);
+    m_cx.push_back(r.center.x);
+    m_cy.push_back(r.center.y);
+    m_r.push_back(r.radius);
+    m_nameLength.push_back((unsigned int)r.image.size());
+    m_names += r.image;
+
+    if((int)m_index.size() >= m_chunkRecords)
+        return writeChunk();
+    return true;
+}
+
+bool ColumnarResultSink::flush()
+{
+    return m_file && writeChunk() && std::fflush(m_file) == 0;
+}
+
+bool ColumnarResultSink::writeChunk()
+{
+    if(m_index.empty())
+        return true;
+
+    bool ok = writeU32(m_file, (unsigned int)m_index.size())
+            && writeU32(m_file, (unsigned int)m_edgeLine.size())
+            && writeU32(m_file, (unsigned int)m_names.size())
+            && writeColumn(m_file, m_index) && writeColumn(m_file, m_flags)
+            && writeColumn(m_file, m_lineCount) && writeColumn(m_file, m_edgeCount)
+            && writeColumn(m_file, m_x1) && writeColumn(m_file, m_y1)
+            && writeColumn(m_file, m_x2) && writeColumn(m_file, m_y2)
+            && writeColumn(m_file, m_cx) && writeColumn(m_file, m_cy) && writeColumn(m_file, m_r)
+            && writeColumn(m_file, m_nameLength)
+            && (m_names.empty() || std::fwrite(m_names.data(), 1, m_names.size(), m_file) == m_names.size())
+            && writeColumn(m_file, m_edgeLine) && writeColumn(m_file, m_edgeX)
+            && writeColumn(m_file, m_edgeY) && writeColumn(m_file, m_edgeSlope);
+
+    clearChunk();
+    return ok;
+}
+
+void ColumnarResultSink::clearChunk()
+{
+    //clear() keeps the capacity, the next chunk fills the same memory
+    m_index.clear(); m_flags.clear();
+    m_lineCount.clear(); m_edgeCount.clear();
+    m_x1.clear(); m_y1.clear(); m_x2.clear(); m_y2.clear();
+    m_cx.clear(); m_cy.clear(); m_r.clear();
+    m_nameLength.clear(); m_names.clear();
+    m_edgeLine.clear(); m_edgeX.clear(); m_edgeY.clear(); m_edgeSlope.clear();
+}
+
+cv::Ptr<ResultSink> openResultSink(const std::string &path, std::string *error)
+{
+    if(endsWith(path, ".csv")){
+        cv::Ptr<CsvResultSink> sink = cv::makePtr<CsvResultSink>(path);
+        if(sink->isOpen())
+            return sink;
+    }
+    else{
+        cv::Ptr<ColumnarResultSink> sink = cv::makePtr<ColumnarResultSink>(path);
+        if(sink->isOpen())
+            return sink;
+    }
+    if(error)
+        *error = "cannot append results to " + path;
+    return cv::Ptr<ResultSink>();
+}
@@ -0,0 +1,127 @@
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// Measurement results written to a file as they come: the edge points of
+// every line plus the fitted line and circle, one record per image. Files
+// are opened for append and written through a large buffer, so a batch
+// streams its results without holding them and a second run adds to the
+// same file. Not thread safe; serialise the calls.
+//
+// The edges are those of the offset lines or rays, the points the line and
+// circle are fitted to; the edges found on the AB line itself are not
+// recorded (measurecli counts them in its stdout "main_edges" column).
+
+struct MeasureRecord
+{
+    MeasureRecord();
+
+    int index;                      // image number in the batch
+    std::string image;              // path or name, may be empty
+    bool ok;                        // false: the image was unreadable, nothing below is set
+
+    std::vector< std::vector<cv::Point3f> > lines;  // edge points per offset line or ray, z 1 = up slope, 2 = down slope
+
+    bool lineFitted;
+    cv::Point p1,p2;
+    bool circleFitted;
+    cv::Point2f center;
+    float radius;
+};
+
+class ResultSink
+{
+public:
+    virtual ~ResultSink() {}
+
+    virtual bool write(const MeasureRecord &record) = 0;
+    virtual bool flush() = 0;       // hand everything buffered to the file
+};
+
+// One row per value, long format:
+//
+//   index,image,kind,line,x,y,value
+//   3,"parts/a.png",edge,0,214.37,188.02,2    value = slope type
+//   3,"parts/a.png",line,,210,120,            two rows, the fitted end points
+//   3,"parts/a.png",circle,,300.50,301.25,88.10   value = radius
+//   4,"parts/b.png",unreadable,,,,
+//
+// Image names are always quoted as RFC 4180 asks, see csvQuote.
+class CsvResultSink : public ResultSink
+{
+public:
+    explicit CsvResultSink(const std::string &path);
+    ~CsvResultSink();
+
+    bool isOpen() const { return m_file != 0; }
+    bool write(const MeasureRecord &record);
+    bool flush();
+
+private:
+    CsvResultSink(const CsvResultSink&);
+    CsvResultSink& operator=(const CsvResultSink&);
+
+    std::FILE *m_file;
+    std::vector<char> m_buffer;
+};
+
+// Compact binary, column by column in chunks of up to chunkRecords records:
+//
+//   "MEASCOL1"
+//   chunk: u32 records, u32 edges, u32 nameBytes
+//          per record columns: i32 index, u8 flags (1 ok, 2 line fitted,
+//              4 circle fitted), u32 lines, u32 edges, i32 x1, y1, x2, y2,
+//              f32 cx, cy, r, u32 nameLength
+//          name bytes, all records back to back
+//          per edge columns: u32 line, f32 x, f32 y, u8 slope
+//
+// A record's edges follow those of the records before it in the chunk.
+// Numbers are in host byte order, little endian on every target we build.
+class ColumnarResultSink : public ResultSink
+{
+public:
+    explicit ColumnarResultSink(const std::string &path, int chunkRecords = 256);
+    ~ColumnarResultSink();
+
+    bool isOpen() const { return m_file != 0; }
+    bool write(const MeasureRecord &record);
+    bool flush();
+
+private:
+    ColumnarResultSink(const ColumnarResultSink&);
+    ColumnarResultSink& operator=(const ColumnarResultSink&);
+
+    bool writeChunk();
+    void clearChunk();
+
+    std::FILE *m_file;
+    int m_chunkRecords;
+
+    // the chunk being filled
+    std::vector<int> m_index;
+    std::vector<unsigned char> m_flags;
+    std::vector<unsigned int> m_lineCount,m_edgeCount;
+    std::vector<int> m_x1,m_y1,m_x2,m_y2;
+    std::vector<float> m_cx,m_cy,m_r;
+    std::vector<unsigned int> m_nameLength;
+    std::string m_names;
+    std::vector<unsigned int> m_edgeLine;
+    std::vector<float> m_edgeX,m_edgeY;
+    std::vector<unsigned char> m_edgeSlope;
+};
+
+// "text" as one CSV field: in double quotes, each quote inside doubled, so
+// commas, quotes and line breaks in a path survive.
+std::string csvQuote(const std::string &text);
+
+// CSV for a ".csv" path, the columnar format for anything else. Empty with
+// a message in "error" when the file cannot be opened for append, or when
+// it exists and is not a file of that format.
+cv::Ptr<ResultSink> openResultSink(const std::string &path, std::string *error = 0);
+
+#endif // RESULTSINK_H
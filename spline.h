@@ -44,39 +44,14 @@ namespace
 namespace tk
 {
 
-// band matrix solver
-class band_matrix
-{
-private:
-    std::vector< std::vector<double> > m_upper;  // upper band
-    std::vector< std::vector<double> > m_lower;  // lower band
-public:
-    band_matrix() {};                             // constructor
-    band_matrix(int dim, int n_u, int n_l);       // constructor
-    ~band_matrix() {};                            // destructor
-    void resize(int dim, int n_u, int n_l);      // init with dim,n_u,n_l
-    int dim() const;                             // matrix dimension
-    int num_upper() const
-    {
-        return m_upper.size()-1;
-    }
-    int num_lower() const
-    {
-        return m_lower.size()-1;
-    }
-    // access operator
-    double & operator () (int i, int j);            // write
-    double   operator () (int i, int j) const;      // read
-    // we can store an additional diogonal (in m_lower)
-    double& saved_diag(int i);
-    double  saved_diag(int i) const;
-    void lu_decompose();
-    std::vector<double> r_solve(const std::vector<double>& b) const;
-    std::vector<double> l_solve(const std::vector<double>& b) const;
-    std::vector<double> lu_solve(const std::vector<double>& b,
-                                 bool is_lu_decomposed=false);
-
-};
+// tridiagonal solver (Thomas algorithm), the system is
+// sub[i]*x[i-1] + diag[i]*x[i] + sup[i]*x[i+1] = rhs[i];
+// sup and rhs are overwritten, the solution is written to x
+void tridiagonal_solve(const std::vector<double>& sub,
+                       const std::vector<double>& diag,
+                       std::vector<double>& sup,
+                       std::vector<double>& rhs,
+                       std::vector<double>& x);
 
 
 // spline interpolation
@@ -89,7 +64,9 @@ public:
     };
 
 private:
-    std::vector<double> m_x,m_y;            // x,y coordinates of points
+    std::vector<double> m_x,m_y;            // x,y coordinates of points, when copied
+    const double *m_px, *m_py;              // x,y coordinates in use (m_x,m_y or the caller's)
+    int m_n;                                // number of points
     // interpolation parameters
     // f(x) = a*(x-x_i)^3 + b*(x-x_i)^2 + c*(x-x_i) + y_i
     std::vector<double> m_a,m_b,m_c;        // spline coefficients
@@ -97,15 +74,22 @@ private:
     bd_type m_left, m_right;
     double  m_left_value, m_right_value;
     bool    m_force_linear_extrapolation;
+    // scratch for the tridiagonal solve, kept between set_points() calls
+    std::vector<double> m_sub, m_diag, m_sup, m_rhs;
 
 public:
     // set default boundary condition to be zero curvature at both ends
-    spline(): m_left(second_deriv), m_right(second_deriv),
+    spline(): m_px(0), m_py(0), m_n(0),
+        m_left(second_deriv), m_right(second_deriv),
         m_left_value(0.0), m_right_value(0.0),
         m_force_linear_extrapolation(false)
     {
         ;
     }
+    // a copy of a spline whose points were copied in uses its own copy of
+    // them; the caller's arrays of the pointer overload stay shared
+    spline(const spline& other);
+    spline& operator=(const spline& other);
 
     // optional, but if called it has to come be before set_points()
     void set_boundary(bd_type left, double left_value,
@@ -113,8 +97,15 @@ public:
                       bool force_linear_extrapolation=false);
     void set_points(const std::vector<double>& x,
                     const std::vector<double>& y, bool cubic_spline=true);
+    // same without copying: x and y must stay valid while the spline is used
+    void set_points(const double* x, const double* y, int n,
+                    bool cubic_spline=true);
     double operator() (double x) const;
     double deriv(int order, double x) const;
+    // steepest rising (sign>0) or falling (sign<0) slope between the first
+    // and the last knot, found analytically from the roots of f'' of each
+    // cubic piece; returns f' there and its position in x_pos
+    double steepest_slope(int sign, double& x_pos) const;
 };
 
 
@@ -124,151 +115,37 @@ public:
 // ---------------------------------------------------------------------
 
 
-// band_matrix implementation
-// -------------------------
-
-band_matrix::band_matrix(int dim, int n_u, int n_l)
-{
-    resize(dim, n_u, n_l);
-}
-void band_matrix::resize(int dim, int n_u, int n_l)
-{
-    assert(dim>0);
-    assert(n_u>=0);
-    assert(n_l>=0);
-    m_upper.resize(n_u+1);
-    m_lower.resize(n_l+1);
-    for(size_t i=0; i<m_upper.size(); i++) {
-        m_upper[i].resize(dim);
-    }
-    for(size_t i=0; i<m_lower.size(); i++) {
-        m_lower[i].resize(dim);
-    }
-}
-int band_matrix::dim() const
-{
-    if(m_upper.size()>0) {
-        return m_upper[0].size();
-    } else {
-        return 0;
-    }
-}
-
-
-// defines the new operator (), so that we can access the elements
-// by A(i,j), index going from i=0,...,dim()-1
-double & band_matrix::operator () (int i, int j)
-{
-    int k=j-i;       // what band is the entry
-    assert( (i>=0) && (i<dim()) && (j>=0) && (j<dim()) );
-    assert( (-num_lower()<=k) && (k<=num_upper()) );
-    // k=0 -> diogonal, k<0 lower left part, k>0 upper right part
-    if(k>=0)   return m_upper[k][i];
-    else	    return m_lower[-k][i];
-}
-double band_matrix::operator () (int i, int j) const
-{
-    int k=j-i;       // what band is the entry
-    assert( (i>=0) && (i<dim()) && (j>=0) && (j<dim()) );
-    assert( (-num_lower()<=k) && (k<=num_upper()) );
-    // k=0 -> diogonal, k<0 lower left part, k>0 upper right part
-    if(k>=0)   return m_upper[k][i];
-    else	    return m_lower[-k][i];
-}
-// second diag (used in LU decomposition), saved in m_lower
-double band_matrix::saved_diag(int i) const
-{
-    assert( (i>=0) && (i<dim()) );
-    return m_lower[0][i];
-}
-double & band_matrix::saved_diag(int i)
-{
-    assert( (i>=0) && (i<dim()) );
-    return m_lower[0][i];
-}
-
-// LR-Decomposition of a band matrix
-void band_matrix::lu_decompose()
-{
-    int  i_max,j_max;
-    int  j_min;
-    double x;
-
-    // preconditioning
-    // normalize column i so that a_ii=1
-    for(int i=0; i<this->dim(); i++) {
-        assert(this->operator()(i,i)!=0.0);
-        this->saved_diag(i)=1.0/this->operator()(i,i);
-        j_min=std::max(0,i-this->num_lower());
-        j_max=std::min(this->dim()-1,i+this->num_upper());
-        for(int j=j_min; j<=j_max; j++) {
-            this->operator()(i,j) *= this->saved_diag(i);
-        }
-        this->operator()(i,i)=1.0;          // prevents rounding errors
-    }
+// tridiagonal solver implementation
+// ---------------------------------
 
-    // Gauss LR-Decomposition
-    for(int k=0; k<this->dim(); k++) {
-        i_max=std::min(this->dim()-1,k+this->num_lower());  // num_lower not a mistake!
-        for(int i=k+1; i<=i_max; i++) {
-            assert(this->operator()(k,k)!=0.0);
-            x=-this->operator()(i,k)/this->operator()(k,k);
-            this->operator()(i,k)=-x;                         // assembly part of L
-            j_max=std::min(this->dim()-1,k+this->num_upper());
-            for(int j=k+1; j<=j_max; j++) {
-                // assembly part of R
-                this->operator()(i,j)=this->operator()(i,j)+x*this->operator()(k,j);
-            }
-        }
-    }
-}
-// solves Ly=b
-std::vector<double> band_matrix::l_solve(const std::vector<double>& b) const
-{
-    assert( this->dim()==(int)b.size() );
-    std::vector<double> x(this->dim());
-    int j_start;
-    double sum;
-    for(int i=0; i<this->dim(); i++) {
-        sum=0;
-        j_start=std::max(0,i-this->num_lower());
-        for(int j=j_start; j<i; j++) sum += this->operator()(i,j)*x[j];
-        x[i]=(b[i]*this->saved_diag(i)) - sum;
-    }
-    return x;
-}
-// solves Rx=y
-std::vector<double> band_matrix::r_solve(const std::vector<double>& b) const
+void tridiagonal_solve(const std::vector<double>& sub,
+                       const std::vector<double>& diag,
+                       std::vector<double>& sup,
+                       std::vector<double>& rhs,
+                       std::vector<double>& x)
 {
-    assert( this->dim()==(int)b.size() );
-    std::vector<double> x(this->dim());
-    int j_stop;
-    double sum;
-    for(int i=this->dim()-1; i>=0; i--) {
-        sum=0;
-        j_stop=std::min(this->dim()-1,i+this->num_upper());
-        for(int j=i+1; j<=j_stop; j++) sum += this->operator()(i,j)*x[j];
-        x[i]=( b[i] - sum ) / this->operator()(i,i);
+    int n=diag.size();
+    assert(n>0 && (int)sub.size()==n && (int)sup.size()==n && (int)rhs.size()==n);
+    x.resize(n);
+
+    // forward elimination, no pivoting: the spline system is diagonally dominant
+    assert(diag[0]!=0.0);
+    sup[0]/=diag[0];
+    rhs[0]/=diag[0];
+    for(int i=1; i<n; i++) {
+        double m=diag[i]-sub[i]*sup[i-1];
+        assert(m!=0.0);
+        sup[i]/=m;
+        rhs[i]=(rhs[i]-sub[i]*rhs[i-1])/m;
     }
-    return x;
-}
-
-std::vector<double> band_matrix::lu_solve(const std::vector<double>& b,
-        bool is_lu_decomposed)
-{
-    assert( this->dim()==(int)b.size() );
-    std::vector<double>  x,y;
-    if(is_lu_decomposed==false) {
-        this->lu_decompose();
+    // back substitution
+    x[n-1]=rhs[n-1];
+    for(int i=n-2; i>=0; i--) {
+        x[i]=rhs[i]-sup[i]*x[i+1];
     }
-    y=this->l_solve(b);
-    x=this->r_solve(y);
-    return x;
 }
 
 
-
-
 // spline implementation
 // -----------------------
 
@@ -276,7 +153,7 @@ void spline::set_boundary(spline::bd_type left, double left_value,
                           spline::bd_type right, double right_value,
                           bool force_linear_extrapolation)
 {
-    assert(m_x.size()==0);          // set_points() must not have happened yet
+    assert(m_n==0);                 // set_points() must not have happened yet
     m_left=left;
     m_right=right;
     m_left_value=left_value;
@@ -285,63 +162,105 @@ void spline::set_boundary(spline::bd_type left, double left_value,
 }
 
 
+spline::spline(const spline& other): m_px(0), m_py(0), m_n(0)
+{
+    *this=other;
+}
+
+spline& spline::operator=(const spline& other)
+{
+    if(this==&other) {
+        return *this;
+    }
+    m_x=other.m_x;
+    m_y=other.m_y;
+    bool own_points = !other.m_x.empty() && other.m_px==other.m_x.data();
+    m_px = own_points ? m_x.data() : other.m_px;
+    m_py = own_points ? m_y.data() : other.m_py;
+    m_n=other.m_n;
+    m_a=other.m_a;
+    m_b=other.m_b;
+    m_c=other.m_c;
+    m_b0=other.m_b0;
+    m_c0=other.m_c0;
+    m_left=other.m_left;
+    m_right=other.m_right;
+    m_left_value=other.m_left_value;
+    m_right_value=other.m_right_value;
+    m_force_linear_extrapolation=other.m_force_linear_extrapolation;
+    // the solver scratch is not state, it is regrown by set_points()
+    return *this;
+}
+
 void spline::set_points(const std::vector<double>& x,
                         const std::vector<double>& y, bool cubic_spline)
 {
     assert(x.size()==y.size());
-    assert(x.size()>2);
     m_x=x;
     m_y=y;
-    int   n=x.size();
+    set_points(m_x.data(), m_y.data(), (int)m_x.size(), cubic_spline);
+}
+
+void spline::set_points(const double* x, const double* y, int n,
+                        bool cubic_spline)
+{
+    assert(n>2);
+    m_px=x;
+    m_py=y;
+    m_n=n;
     // TODO: maybe sort x and y, rather than returning an error
     for(int i=0; i<n-1; i++) {
-        assert(m_x[i]<m_x[i+1]);
+        assert(x[i]<x[i+1]);
     }
 
     if(cubic_spline==true) { // cubic spline interpolation
-        // setting up the matrix and right hand side of the equation system
-        // for the parameters b[]
-        band_matrix A(n,1,1);
-        std::vector<double>  rhs(n);
+        // setting up the tridiagonal matrix and right hand side of the
+        // equation system for the parameters b[]
+        m_sub.resize(n);
+        m_diag.resize(n);
+        m_sup.resize(n);
+        m_rhs.resize(n);
         for(int i=1; i<n-1; i++) {
-            A(i,i-1)=1.0/3.0*(x[i]-x[i-1]);
-            A(i,i)=2.0/3.0*(x[i+1]-x[i-1]);
-            A(i,i+1)=1.0/3.0*(x[i+1]-x[i]);
-            rhs[i]=(y[i+1]-y[i])/(x[i+1]-x[i]) - (y[i]-y[i-1])/(x[i]-x[i-1]);
+            m_sub[i]=1.0/3.0*(x[i]-x[i-1]);
+            m_diag[i]=2.0/3.0*(x[i+1]-x[i-1]);
+            m_sup[i]=1.0/3.0*(x[i+1]-x[i]);
+            m_rhs[i]=(y[i+1]-y[i])/(x[i+1]-x[i]) - (y[i]-y[i-1])/(x[i]-x[i-1]);
         }
         // boundary conditions
+        m_sub[0]=0.0;
         if(m_left == spline::second_deriv) {
             // 2*b[0] = f''
-            A(0,0)=2.0;
-            A(0,1)=0.0;
-            rhs[0]=m_left_value;
+            m_diag[0]=2.0;
+            m_sup[0]=0.0;
+            m_rhs[0]=m_left_value;
         } else if(m_left == spline::first_deriv) {
             // c[0] = f', needs to be re-expressed in terms of b:
             // (2b[0]+b[1])(x[1]-x[0]) = 3 ((y[1]-y[0])/(x[1]-x[0]) - f')
-            A(0,0)=2.0*(x[1]-x[0]);
-            A(0,1)=1.0*(x[1]-x[0]);
-            rhs[0]=3.0*((y[1]-y[0])/(x[1]-x[0])-m_left_value);
+            m_diag[0]=2.0*(x[1]-x[0]);
+            m_sup[0]=1.0*(x[1]-x[0]);
+            m_rhs[0]=3.0*((y[1]-y[0])/(x[1]-x[0])-m_left_value);
         } else {
             assert(false);
         }
+        m_sup[n-1]=0.0;
         if(m_right == spline::second_deriv) {
             // 2*b[n-1] = f''
-            A(n-1,n-1)=2.0;
-            A(n-1,n-2)=0.0;
-            rhs[n-1]=m_right_value;
+            m_diag[n-1]=2.0;
+            m_sub[n-1]=0.0;
+            m_rhs[n-1]=m_right_value;
         } else if(m_right == spline::first_deriv) {
             // c[n-1] = f', needs to be re-expressed in terms of b:
             // (b[n-2]+2b[n-1])(x[n-1]-x[n-2])
             // = 3 (f' - (y[n-1]-y[n-2])/(x[n-1]-x[n-2]))
-            A(n-1,n-1)=2.0*(x[n-1]-x[n-2]);
-            A(n-1,n-2)=1.0*(x[n-1]-x[n-2]);
-            rhs[n-1]=3.0*(m_right_value-(y[n-1]-y[n-2])/(x[n-1]-x[n-2]));
+            m_diag[n-1]=2.0*(x[n-1]-x[n-2]);
+            m_sub[n-1]=1.0*(x[n-1]-x[n-2]);
+            m_rhs[n-1]=3.0*(m_right_value-(y[n-1]-y[n-2])/(x[n-1]-x[n-2]));
         } else {
             assert(false);
         }
 
         // solve the equation system to obtain the parameters b[]
-        m_b=A.lu_solve(rhs);
+        tridiagonal_solve(m_sub, m_diag, m_sup, m_rhs, m_b);
 
         // calculate parameters a[] and c[] based on b[]
         m_a.resize(n);
@@ -358,7 +277,7 @@ void spline::set_points(const std::vector<double>& x,
         for(int i=0; i<n-1; i++) {
             m_a[i]=0.0;
             m_b[i]=0.0;
-            m_c[i]=(m_y[i+1]-m_y[i])/(m_x[i+1]-m_x[i]);
+            m_c[i]=(y[i+1]-y[i])/(x[i+1]-x[i]);
         }
     }
 
@@ -378,23 +297,23 @@ void spline::set_points(const std::vector<double>& x,
 
 double spline::operator() (double x) const
 {
-    size_t n=m_x.size();
-    // find the closest point m_x[idx] < x, idx=0 even if x<m_x[0]
-    std::vector<double>::const_iterator it;
-    it=std::lower_bound(m_x.begin(),m_x.end(),x);
-    int idx=std::max( int(it-m_x.begin())-1, 0);
+    size_t n=m_n;
+    // find the closest point m_px[idx] < x, idx=0 even if x<m_px[0]
+    const double* it;
+    it=std::lower_bound(m_px,m_px+n,x);
+    int idx=std::max( int(it-m_px)-1, 0);
 
-    double h=x-m_x[idx];
+    double h=x-m_px[idx];
     double interpol;
-    if(x<m_x[0]) {
+    if(x<m_px[0]) {
         // extrapolation to the left
-        interpol=(m_b0*h + m_c0)*h + m_y[0];
-    } else if(x>m_x[n-1]) {
+        interpol=(m_b0*h + m_c0)*h + m_py[0];
+    } else if(x>m_px[n-1]) {
         // extrapolation to the right
-        interpol=(m_b[n-1]*h + m_c[n-1])*h + m_y[n-1];
+        interpol=(m_b[n-1]*h + m_c[n-1])*h + m_py[n-1];
     } else {
         // interpolation
-        interpol=((m_a[idx]*h + m_b[idx])*h + m_c[idx])*h + m_y[idx];
+        interpol=((m_a[idx]*h + m_b[idx])*h + m_c[idx])*h + m_py[idx];
     }
     return interpol;
 }
@@ -403,15 +322,15 @@ double spline::deriv(int order, double x) const
 {
     assert(order>0);
 
-    size_t n=m_x.size();
-    // find the closest point m_x[idx] < x, idx=0 even if x<m_x[0]
-    std::vector<double>::const_iterator it;
-    it=std::lower_bound(m_x.begin(),m_x.end(),x);
-    int idx=std::max( int(it-m_x.begin())-1, 0);
+    size_t n=m_n;
+    // find the closest point m_px[idx] < x, idx=0 even if x<m_px[0]
+    const double* it;
+    it=std::lower_bound(m_px,m_px+n,x);
+    int idx=std::max( int(it-m_px)-1, 0);
 
-    double h=x-m_x[idx];
+    double h=x-m_px[idx];
     double interpol;
-    if(x<m_x[0]) {
+    if(x<m_px[0]) {
         // extrapolation to the left
         switch(order) {
         case 1:
@@ -424,7 +343,7 @@ double spline::deriv(int order, double x) const
             interpol=0.0;
             break;
         }
-    } else if(x>m_x[n-1]) {
+    } else if(x>m_px[n-1]) {
         // extrapolation to the right
         switch(order) {
         case 1:
@@ -459,6 +378,40 @@ double spline::deriv(int order, double x) const
 
 
 
+double spline::steepest_slope(int sign, double& x_pos) const
+{
+    assert(m_n>1);
+    size_t n=m_n;
+    double s = (sign<0) ? -1.0 : 1.0;
+
+    // f'(h) = 3a*h^2 + 2b*h + c is a parabola on each piece, its extremum
+    // is the inflection point h=-b/(3a); otherwise the steepest point of the
+    // piece is one of its knots
+    x_pos=m_px[0];
+    double best=m_c[0];
+    for(size_t i=0; i<n-1; i++) {
+        double len=m_px[i+1]-m_px[i];
+        double cand[3];
+        int count=0;
+        cand[count++]=0.0;
+        cand[count++]=len;
+        if(m_a[i]!=0.0) {
+            double h=-m_b[i]/(3.0*m_a[i]);
+            if(h>0.0 && h<len) cand[count++]=h;
+        }
+        for(int k=0; k<count; k++) {
+            double h=cand[k];
+            double d=(3.0*m_a[i]*h + 2.0*m_b[i])*h + m_c[i];
+            if(s*d > s*best) {
+                best=d;
+                x_pos=m_px[i]+h;
+            }
+        }
+    }
+    return best;
+}
+
+
 } // namespace tk
 
 